@@ -2,30 +2,59 @@
 
 #include "VRGesturePluginPrivatePCH.h"
 #include "RandomNumbers.h"
-#include <random>
 
+RandomNumbers::RandomNumbers()
+{
+	static uint64 NextStream = 0;
+	SetSeed(FPlatformTime::Cycles64(), NextStream++);
+}
 
-// random number generator
-std::random_device                      rd;
-std::mt19937                            normgen;
-std::normal_distribution<float>         *rndnorm;
-std::default_random_engine              unifgen;
-std::uniform_real_distribution<float>   *rndunif;
+RandomNumbers::RandomNumbers(uint64 Seed, uint64 Stream)
+{
+	SetSeed(Seed, Stream);
+}
 
-RandomNumbers::RandomNumbers()
+void RandomNumbers::SetSeed(uint64 Seed, uint64 Stream)
 {
-	normgen = std::mt19937(rd());
-	rndnorm = new std::normal_distribution<float>(0.0, 1.0);
-	unifgen = std::default_random_engine(rd());
-	rndunif = new std::uniform_real_distribution<float>(0.0, 1.0);
+	State.State = 0;
+	State.Increment = (Stream << 1) | 1;
+	State.SpareNormal = 0.0f;
+	State.bHasSpareNormal = 0;
+	Next();
+	State.State += Seed;
+	Next();
+}
+
+uint32 RandomNumbers::Next()
+{
+	uint64 Old = State.State;
+	State.State = Old * 6364136223846793005ULL + State.Increment;
+	uint32 XorShifted = (uint32)(((Old >> 18) ^ Old) >> 27);
+	uint32 Rotation = (uint32)(Old >> 59);
+	return (XorShifted >> Rotation) | (XorShifted << ((0u - Rotation) & 31));
 }
 
 float RandomNumbers::GetRandomUniform()
 {
-	return (*rndunif)(unifgen); 
+	// 24 bits, exactly representable as float
+	return (Next() >> 8) * (1.0f / 16777216.0f);
 }
 
 float RandomNumbers::GetRandomNormal()
 {
-	return (*rndnorm)(normgen); 
-}
\ No newline at end of file
+	if (State.bHasSpareNormal)
+	{
+		State.bHasSpareNormal = 0;
+		return State.SpareNormal;
+	}
+
+	// Box-Muller, the second value is kept for the next call
+	float U1 = 1.0f - GetRandomUniform();    // ]0;1]
+	float U2 = GetRandomUniform();
+	float Radius = FMath::Sqrt(-2.0f * FMath::Loge(U1));
+	float Angle = 2.0f * PI * U2;
+
+	State.SpareNormal = Radius * FMath::Sin(Angle);
+	State.bHasSpareNormal = 1;
+	return Radius * FMath::Cos(Angle);
+}
@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRGesturePluginPrivatePCH.h"
+#include "VRGestureAutoTuner.h"
+#include "VRGestureRecognizer.h"
+#include "ParallelFor.h"
+
+void FVRGestureAutoTuner::RecordTemplates(UVRGestureRecognizer* Recognizer, const TArray<FVRGestureTrajectory>& Trajectories, TArray<int32>& OutTestIndices)
+{
+	TArray<int32> RecordedIDs;
+	OutTestIndices.Reset();
+
+	for (int32 i = 0; i < Trajectories.Num(); i++)
+	{
+		const FVRGestureTrajectory& Trajectory = Trajectories[i];
+		if (RecordedIDs.Contains(Trajectory.GestureID))
+		{
+			OutTestIndices.Add(i);
+			continue;
+		}
+
+		Recognizer->StartRecordingNewGesture(Trajectory.GestureID);
+		for (FVector Point : Trajectory.Points)
+		{
+			Recognizer->Tick(Point);
+		}
+		Recognizer->StopRecordingGesture();
+		RecordedIDs.Add(Trajectory.GestureID);
+	}
+}
+
+FVRGestureTuningResult FVRGestureAutoTuner::Evaluate(UVRGestureRecognizer* Recognizer, const TArray<FVRGestureTrajectory>& Trajectories, const TArray<int32>& TestIndices, const FVRGestureTuningTarget& Target)
+{
+	FVRGestureTuningResult Result;
+	Result.Parameters = Recognizer->getEngineParameters();
+
+	int32 NumRecognized = 0;
+	float LatencySum = 0.0f;
+	float LatencySamplesSum = 0.0f;
+	uint64 Cycles = 0;
+	int32 NumTicks = 0;
+
+	for (int32 TestIndex : TestIndices)
+	{
+		const FVRGestureTrajectory& Trajectory = Trajectories[TestIndex];
+		if (Trajectory.Points.Num() == 0)
+			continue;
+
+		// same random sequence for a trajectory whatever the configuration
+		Recognizer->setRandomSeed(TestIndex);
+		Recognizer->StartListening();
+
+		// first sample from which the right gesture stays the most probable
+		int32 DecidedAt = INDEX_NONE;
+		for (int32 i = 0; i < Trajectory.Points.Num(); i++)
+		{
+			FVector Point = Trajectory.Points[i];
+			uint32 StartCycles = FPlatformTime::Cycles();
+			Recognizer->Tick(Point);
+			Cycles += FPlatformTime::Cycles() - StartCycles;
+			NumTicks++;
+
+			if (Recognizer->getMostProbableGesture() != Trajectory.GestureID)
+				DecidedAt = INDEX_NONE;
+			else if (DecidedAt == INDEX_NONE)
+				DecidedAt = i;
+		}
+
+		Recognizer->StopListening();
+
+		if (DecidedAt != INDEX_NONE)
+		{
+			// latency counted from the onset, deciding during the idle start is not faster
+			int32 Onset = FMath::Clamp(Trajectory.Onset, 0, Trajectory.Points.Num() - 1);
+			int32 Samples = FMath::Max(DecidedAt + 1 - Onset, 1);
+			NumRecognized++;
+			LatencySum += (float)Samples / (float)(Trajectory.Points.Num() - Onset);
+			LatencySamplesSum += Samples;
+		}
+	}
+
+	Result.Accuracy = TestIndices.Num() > 0 ? (float)NumRecognized / (float)TestIndices.Num() : 0.0f;
+	Result.Latency = NumRecognized > 0 ? LatencySum / NumRecognized : 1.0f;
+	Result.LatencySamples = NumRecognized > 0 ? LatencySamplesSum / NumRecognized : 0.0f;
+	Result.CostUs = NumTicks > 0 ? (float)(FPlatformTime::GetSecondsPerCycle() * Cycles * 1000000.0 / NumTicks) : 0.0f;
+	Result.bMeetsTarget = Result.Accuracy >= Target.MinAccuracy && Result.Latency <= Target.MaxLatency;
+	return Result;
+}
+
+bool FVRGestureAutoTuner::Tune(const TArray<FVRGestureTrajectory>& Trajectories, const FVRGestureTuningSpace& Space, const FVRGestureTuningTarget& Target,
+	FVRGestureTuningResult& OutBest, TArray<FVRGestureTuningResult>* OutAll)
+{
+	check(IsInGameThread());
+
+	// one recognizer per configuration, created and trained on the game thread
+	TArray<UVRGestureRecognizer*> Recognizers;
+	TArray<int32> TestIndices;
+	for (int32 NumberParticles : Space.NumberParticles)
+	for (float Tolerance : Space.Tolerances)
+	for (float ResamplingRatio : Space.ResamplingRatios)
+	for (float DynamicsVariance : Space.DynamicsVariances)
+	for (float ScalingsVariance : Space.ScalingsVariances)
+	{
+		UVRGestureRecognizer* Recognizer = NewObject<UVRGestureRecognizer>();
+		Recognizer->AddToRoot();
+		Recognizer->bBudgetManaged = false;
+
+		FGREngineParameters Parameters = Recognizer->getEngineParameters();
+		Parameters.numberParticles = NumberParticles;
+		Parameters.tolerance = Tolerance;
+		Parameters.resamplingThreshold = FMath::Max(1, (int32)(ResamplingRatio * NumberParticles));
+		Parameters.dynamicsVariance = FVector(DynamicsVariance);
+		Parameters.scalingsVariance = FVector(ScalingsVariance);
+		Recognizer->setEngineParameters(Parameters);
+
+		RecordTemplates(Recognizer, Trajectories, TestIndices);
+		Recognizers.Add(Recognizer);
+	}
+
+	TArray<FVRGestureTuningResult> Results;
+	Results.SetNum(Recognizers.Num());
+	ParallelFor(Recognizers.Num(), [&](int32 Index)
+	{
+		Results[Index] = Evaluate(Recognizers[Index], Trajectories, TestIndices, Target);
+	});
+
+	for (UVRGestureRecognizer* Recognizer : Recognizers)
+	{
+		Recognizer->RemoveFromRoot();
+	}
+
+	// cheapest configuration meeting the target, otherwise the most accurate
+	int32 Best = INDEX_NONE;
+	for (int32 i = 0; i < Results.Num(); i++)
+	{
+		const FVRGestureTuningResult& Result = Results[i];
+		UE_LOG(VRGesturePluginLog, Log, TEXT("[FVRGestureAutoTuner::Tune] particles %d tolerance %.3f resampling %d: accuracy %.2f latency %.2f (%.1f samples) cost %.1fus"),
+			Result.Parameters.numberParticles, Result.Parameters.tolerance, Result.Parameters.resamplingThreshold, Result.Accuracy, Result.Latency, Result.LatencySamples, Result.CostUs);
+
+		if (Best == INDEX_NONE)
+		{
+			Best = i;
+		}
+		else if (Result.bMeetsTarget != Results[Best].bMeetsTarget)
+		{
+			if (Result.bMeetsTarget)
+				Best = i;
+		}
+		else if (Result.bMeetsTarget ? Result.CostUs < Results[Best].CostUs : Result.Accuracy > Results[Best].Accuracy)
+		{
+			Best = i;
+		}
+	}
+
+	if (OutAll)
+	{
+		*OutAll = Results;
+	}
+
+	if (Best == INDEX_NONE)
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[FVRGestureAutoTuner::Tune] Empty tuning space"));
+		return false;
+	}
+
+	OutBest = Results[Best];
+	return OutBest.bMeetsTarget;
+}
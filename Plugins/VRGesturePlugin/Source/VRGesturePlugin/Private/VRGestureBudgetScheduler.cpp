@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRGesturePluginPrivatePCH.h"
+#include "VRGestureBudgetScheduler.h"
+#include "VRGestureRecognizer.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Frame budget (us)"), STAT_VRGestureFrameBudget, STATGROUP_VRGesture);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Measured cost (us)"), STAT_VRGestureMeasuredCost, STATGROUP_VRGesture);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active recognizers"), STAT_VRGestureActiveRecognizers, STATGROUP_VRGesture);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Throttled recognizers"), STAT_VRGestureThrottledRecognizers, STATGROUP_VRGesture);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Throttle decisions"), STAT_VRGestureThrottleDecisions, STATGROUP_VRGesture);
+
+static TAutoConsoleVariable<float> CVarVRGestureFrameBudget(
+	TEXT("vrgesture.FrameBudgetUs"),
+	0.0f,
+	TEXT("Per-frame CPU budget of all the gesture recognizers, in microseconds. 0 disables throttling."),
+	ECVF_Default);
+
+// Frames between two throttle decisions, lets the averaged costs settle
+static const int32 DecisionInterval = 10;
+
+// Relax the throttling only when the cost is well under the budget
+static const float RelaxRatio = 0.75f;
+
+FVRGestureBudgetScheduler* FVRGestureBudgetScheduler::Instance = nullptr;
+
+FVRGestureBudgetScheduler::FVRGestureBudgetScheduler()
+	: MeasuredCost(0.0f)
+	, FramesSinceDecision(0)
+{
+}
+
+FVRGestureBudgetScheduler& FVRGestureBudgetScheduler::Get()
+{
+	if (Instance == nullptr)
+	{
+		Instance = new FVRGestureBudgetScheduler();
+	}
+	return *Instance;
+}
+
+void FVRGestureBudgetScheduler::Shutdown()
+{
+	delete Instance;
+	Instance = nullptr;
+}
+
+void FVRGestureBudgetScheduler::Register(UVRGestureRecognizer* Recognizer)
+{
+	Recognizers.AddUnique(Recognizer);
+}
+
+void FVRGestureBudgetScheduler::Unregister(UVRGestureRecognizer* Recognizer)
+{
+	Recognizers.Remove(Recognizer);
+}
+
+void FVRGestureBudgetScheduler::SetFrameBudget(float Microseconds)
+{
+	CVarVRGestureFrameBudget->Set(FMath::Max(Microseconds, 0.0f));
+}
+
+float FVRGestureBudgetScheduler::GetFrameBudget() const
+{
+	return CVarVRGestureFrameBudget.GetValueOnGameThread();
+}
+
+void FVRGestureBudgetScheduler::Tick(float DeltaTime)
+{
+	// Drop recognizers that have been garbage collected
+	Recognizers.RemoveAll([](const TWeakObjectPtr<UVRGestureRecognizer>& Recognizer) { return !Recognizer.IsValid(); });
+
+	MeasuredCost = 0.0f;
+	int32 NumThrottled = 0;
+	for (auto& Recognizer : Recognizers)
+	{
+		MeasuredCost += Recognizer->consumeFrameCost();
+		if (Recognizer->getBudgetThrottle() > 0)
+			NumThrottled++;
+	}
+
+	float Budget = GetFrameBudget();
+
+	SET_FLOAT_STAT(STAT_VRGestureFrameBudget, Budget);
+	SET_FLOAT_STAT(STAT_VRGestureMeasuredCost, MeasuredCost);
+	SET_DWORD_STAT(STAT_VRGestureActiveRecognizers, Recognizers.Num());
+	SET_DWORD_STAT(STAT_VRGestureThrottledRecognizers, NumThrottled);
+
+	if (++FramesSinceDecision < DecisionInterval)
+		return;
+
+	UVRGestureRecognizer* Selected = nullptr;
+
+	if (Budget > 0.0f && MeasuredCost > Budget)
+	{
+		// Over budget: throttle the lowest priority recognizer that can still be throttled
+		for (auto& Recognizer : Recognizers)
+		{
+			if (Recognizer->getBudgetThrottle() < UVRGestureRecognizer::MaxBudgetThrottle
+				&& (Selected == nullptr || Recognizer->getBudgetPriority() < Selected->getBudgetPriority()))
+			{
+				Selected = Recognizer.Get();
+			}
+		}
+
+		if (Selected)
+		{
+			Selected->setBudgetThrottle(Selected->getBudgetThrottle() + 1);
+			UE_LOG(VRGesturePluginLog, Verbose, TEXT("[FVRGestureBudgetScheduler::Tick] Cost %.1fus over budget %.1fus, throttle %s to level %d"), MeasuredCost, Budget, *Selected->GetName(), Selected->getBudgetThrottle());
+		}
+	}
+	else if (Budget <= 0.0f || MeasuredCost < Budget * RelaxRatio)
+	{
+		// Under budget: relax the highest priority throttled recognizer
+		for (auto& Recognizer : Recognizers)
+		{
+			if (Recognizer->getBudgetThrottle() > 0
+				&& (Selected == nullptr || Recognizer->getBudgetPriority() > Selected->getBudgetPriority()))
+			{
+				Selected = Recognizer.Get();
+			}
+		}
+
+		if (Selected)
+		{
+			Selected->setBudgetThrottle(Selected->getBudgetThrottle() - 1);
+			UE_LOG(VRGesturePluginLog, Verbose, TEXT("[FVRGestureBudgetScheduler::Tick] Cost %.1fus under budget %.1fus, relax %s to level %d"), MeasuredCost, Budget, *Selected->GetName(), Selected->getBudgetThrottle());
+		}
+	}
+
+	if (Selected)
+	{
+		INC_DWORD_STAT(STAT_VRGestureThrottleDecisions);
+	}
+	FramesSinceDecision = 0;
+}
+
+TStatId FVRGestureBudgetScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FVRGestureBudgetScheduler, STATGROUP_Tickables);
+}
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRGesturePluginPrivatePCH.h"
+#include "VRGestureFeature.h"
+
+template <int32 Dim>
+static float DistanceKernel(const float* A, const float* B, const float* W)
+{
+	return WeightedSquaredDistance<Dim>(A, B, W);
+}
+
+#define VRGESTURE_KERNEL_4(Base) &DistanceKernel<Base + 1>, &DistanceKernel<Base + 2>, &DistanceKernel<Base + 3>, &DistanceKernel<Base + 4>
+
+// One instantiation per supported dimension, indexed by dimension - 1
+static const FVRGestureDistanceKernel DistanceKernels[VRGESTURE_MAX_FEATURE_DIMENSIONS] =
+{
+	VRGESTURE_KERNEL_4(0), VRGESTURE_KERNEL_4(4), VRGESTURE_KERNEL_4(8), VRGESTURE_KERNEL_4(12),
+	VRGESTURE_KERNEL_4(16), VRGESTURE_KERNEL_4(20), VRGESTURE_KERNEL_4(24), VRGESTURE_KERNEL_4(28)
+};
+
+#undef VRGESTURE_KERNEL_4
+
+FVRGestureDistanceKernel GetDistanceKernel(int32 NumDimensions)
+{
+	if (NumDimensions < 1 || NumDimensions > VRGESTURE_MAX_FEATURE_DIMENSIONS)
+		return nullptr;
+
+	return DistanceKernels[NumDimensions - 1];
+}
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRGesturePluginPrivatePCH.h"
+#include "VRGestureInputPipeline.h"
+
+FVRGestureInputPipeline::FVRGestureInputPipeline()
+{
+	Reset();
+}
+
+void FVRGestureInputPipeline::SetConfig(const FVRGestureInputPipelineConfig& InConfig)
+{
+	Config = InConfig;
+	Reset();
+}
+
+void FVRGestureInputPipeline::Reset()
+{
+	bHasFiltered = false;
+	Filtered = FVector::ZeroVector;
+	FilteredDerivative = FVector::ZeroVector;
+
+	bHasPrevious = false;
+	Previous = FVector::ZeroVector;
+	TimeToNextSample = 0.0f;
+
+	NumFeatureSamples = 0;
+	LastPosition = FVector::ZeroVector;
+	LastVelocity = FVector::ZeroVector;
+}
+
+// One-euro filter (Casiez et al. 2012), each axis in its own SIMD lane:
+// alpha(cutoff) = r / (r + 1) with r = 2 * PI * cutoff * dt
+FVector FVRGestureInputPipeline::OneEuro(const FVector& Position, float DeltaTime)
+{
+	if (!bHasFiltered || DeltaTime <= 0.0f)
+	{
+		if (!bHasFiltered)
+		{
+			Filtered = Position;
+			FilteredDerivative = FVector::ZeroVector;
+			bHasFiltered = true;
+		}
+		return Filtered;
+	}
+
+	const VectorRegister One = VectorSetFloat1(1.0f);
+	const VectorRegister TwoPiDt = VectorSetFloat1(2.0f * PI * DeltaTime);
+
+	VectorRegister X = VectorLoadFloat3_W0(&Position);
+	VectorRegister Prev = VectorLoadFloat3_W0(&Filtered);
+	VectorRegister PrevDerivative = VectorLoadFloat3_W0(&FilteredDerivative);
+
+	// smoothed derivative
+	VectorRegister Derivative = VectorMultiply(VectorSubtract(X, Prev), VectorSetFloat1(1.0f / DeltaTime));
+	VectorRegister R = VectorMultiply(TwoPiDt, VectorSetFloat1(Config.DerivativeCutoff));
+	VectorRegister Alpha = VectorMultiply(R, VectorReciprocal(VectorAdd(R, One)));
+	Derivative = VectorMultiplyAdd(Alpha, VectorSubtract(Derivative, PrevDerivative), PrevDerivative);
+
+	// cutoff adapted to the speed, per axis
+	VectorRegister Cutoff = VectorMultiplyAdd(VectorSetFloat1(Config.Beta), VectorAbs(Derivative), VectorSetFloat1(Config.MinCutoff));
+	R = VectorMultiply(TwoPiDt, Cutoff);
+	Alpha = VectorMultiply(R, VectorReciprocal(VectorAdd(R, One)));
+	VectorRegister Result = VectorMultiplyAdd(Alpha, VectorSubtract(X, Prev), Prev);
+
+	VectorStoreFloat3(Derivative, &FilteredDerivative);
+	VectorStoreFloat3(Result, &Filtered);
+	return Filtered;
+}
+
+// Compute the selected feature of a (resampled) position
+// @return false while there are not enough samples to compute the feature
+bool FVRGestureInputPipeline::ExtractFeature(const FVector& Position, float DeltaTime, FVector& OutFeature)
+{
+	float InvDeltaTime = DeltaTime > 0.0f ? 1.0f / DeltaTime : 0.0f;
+	FVector Velocity = NumFeatureSamples > 0 ? (Position - LastPosition) * InvDeltaTime : FVector::ZeroVector;
+	FVector Acceleration = NumFeatureSamples > 1 ? (Velocity - LastVelocity) * InvDeltaTime : FVector::ZeroVector;
+
+	LastPosition = Position;
+	LastVelocity = Velocity;
+	NumFeatureSamples = FMath::Min(NumFeatureSamples + 1, 3);
+
+	switch (Config.Feature)
+	{
+	case EVRGestureInputFeature::Velocity:
+		OutFeature = Velocity;
+		return NumFeatureSamples > 1;
+
+	case EVRGestureInputFeature::Acceleration:
+		OutFeature = Acceleration;
+		return NumFeatureSamples > 2;
+
+	case EVRGestureInputFeature::Position:
+	default:
+		OutFeature = Position;
+		return true;
+	}
+}
+
+int32 FVRGestureInputPipeline::ProcessBlock(const FVector* Positions, int32 NumPositions, float DeltaTime, FVector* OutSamples, float* OutDeltaTimes, int32 MaxOutputs, int32* OutNumDropped)
+{
+	int32 NumOutputs = 0;
+	int32 NumDropped = 0;
+
+	for (int32 i = 0; i < NumPositions; i++)
+	{
+		FVector Position = Config.bOneEuroFilter ? OneEuro(Positions[i], DeltaTime) : Positions[i];
+
+		if (!Config.bResample || Config.ResampleRate <= 0.0f)
+		{
+			FVector Feature;
+			if (ExtractFeature(Position, DeltaTime, Feature))
+			{
+				if (NumOutputs < MaxOutputs)
+				{
+					OutSamples[NumOutputs] = Feature;
+					OutDeltaTimes[NumOutputs] = DeltaTime;
+					NumOutputs++;
+				}
+				else
+				{
+					if (NumOutputs > 0)
+						OutDeltaTimes[NumOutputs - 1] += DeltaTime;
+					NumDropped++;
+				}
+			}
+			continue;
+		}
+
+		// fixed interval resampling by linear interpolation between the last two inputs
+		const float Interval = 1.0f / Config.ResampleRate;
+		if (!bHasPrevious)
+		{
+			Previous = Position;
+			bHasPrevious = true;
+			TimeToNextSample = 0.0f;
+		}
+
+		while (TimeToNextSample <= DeltaTime)
+		{
+			FVector Resampled = DeltaTime > 0.0f ? FMath::Lerp(Previous, Position, TimeToNextSample / DeltaTime) : Position;
+			TimeToNextSample += Interval;
+
+			FVector Feature;
+			if (ExtractFeature(Resampled, Interval, Feature))
+			{
+				if (NumOutputs < MaxOutputs)
+				{
+					OutSamples[NumOutputs] = Feature;
+					OutDeltaTimes[NumOutputs] = Interval;
+					NumOutputs++;
+				}
+				else
+				{
+					// full buffer (long frame): keep the elapsed time, the filter steps over it
+					if (NumOutputs > 0)
+						OutDeltaTimes[NumOutputs - 1] += Interval;
+					NumDropped++;
+				}
+			}
+		}
+		TimeToNextSample -= DeltaTime;
+		Previous = Position;
+	}
+
+	if (OutNumDropped)
+		*OutNumDropped = NumDropped;
+	return NumOutputs;
+}
+
+void FVRGestureInputPipeline::GetResampleState(bool& bOutHasPrevious, FVector& OutPrevious, float& OutTimeToNextSample) const
+{
+	bOutHasPrevious = bHasPrevious;
+	OutPrevious = Previous;
+	OutTimeToNextSample = TimeToNextSample;
+}
+
+void FVRGestureInputPipeline::SetResampleState(bool bInHasPrevious, const FVector& InPrevious, float InTimeToNextSample)
+{
+	bHasPrevious = bInHasPrevious;
+	Previous = InPrevious;
+	TimeToNextSample = InTimeToNextSample;
+}
@@ -1,6 +1,7 @@
 // Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
 
 #include "VRGesturePluginPrivatePCH.h"
+#include "VRGestureBudgetScheduler.h"
 
 #define LOCTEXT_NAMESPACE "FVRGesturePluginModule"
 
@@ -16,6 +17,7 @@ void FVRGesturePluginModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FVRGestureBudgetScheduler::Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -18,6 +18,14 @@ UVRGestureRecognitionComponent::UVRGestureRecognitionComponent()
 	IsRecordingGesture = false;
 	IsListeningGesture = false;
 
+	Relevance = 1.0f;
+	CurrentLOD = INDEX_NONE;
+	FeatureDimensions = 0;
+	SharedTemplates = nullptr;
+	FixedRate = 0.0f;
+	bDeterministic = false;
+	DeterministicSeed = 0;
+
 }
 
 
@@ -26,6 +34,26 @@ void UVRGestureRecognitionComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	Pipeline.SetConfig(InputPipeline);
+
+	if (GestureRecognizer)
+	{
+		GestureRecognizer->setMotionGate(MotionGate);
+		GestureRecognizer->setFixedRate(FixedRate);
+		if (bDeterministic)
+			GestureRecognizer->setDeterministic(true, (uint64)DeterministicSeed);
+		GestureRecognizer->setPrefilter(Prefilter);
+		GestureRecognizer->setSimplification(Simplification);
+		GestureRecognizer->setOutcomePublishing(OutcomePublishing);
+		if (FeatureDimensions > 0)
+			GestureRecognizer->setDimensions(FeatureDimensions);
+		if (SharedTemplates)
+			GestureRecognizer->setTemplateLibrary(SharedTemplates);
+		for (const FVRGestureProgressTrigger& Trigger : ProgressTriggers)
+			GestureRecognizer->addProgressTrigger(Trigger);
+	}
+	UpdateLOD();
+
 	// Load saved templates
 	if (TemplateFilePath != "None")
 	{
@@ -40,10 +68,29 @@ void UVRGestureRecognitionComponent::TickComponent( float DeltaTime, ELevelTick
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-	if (GetOwner() && GestureRecognizer)
+	// features are pushed by AddFeatureSample
+	if (GetOwner() && GestureRecognizer && FeatureDimensions == 0)
 	{
 		FVector Position = this->GetComponentLocation();
-		GestureRecognizer->Tick(Position);
+
+		FVector Samples[FVRGestureInputPipeline::MaxOutputsPerSample];
+		float SampleDeltaTimes[FVRGestureInputPipeline::MaxOutputsPerSample];
+		int32 NumDropped = 0;
+		int32 NumSamples = Pipeline.ProcessBlock(&Position, 1, DeltaTime, Samples, SampleDeltaTimes, FVRGestureInputPipeline::MaxOutputsPerSample, &NumDropped);
+		for (int32 i = 0; i < NumSamples; i++)
+		{
+			GestureRecognizer->Tick(Samples[i], SampleDeltaTimes[i]);
+		}
+		if (NumDropped > 0)
+		{
+			UE_LOG(VRGesturePluginLog, Verbose, TEXT("[%s::TickComponent] Long frame (%.3f s), %d resampled positions dropped"), *GetName(), DeltaTime, NumDropped);
+		}
+	}
+
+	// nothing is filled nor broadcast without listeners
+	if (GestureRecognizer && OnNewGestureData.IsBound() && GestureRecognizer->publishOutcomes(DeltaTime))
+	{
+		OnNewGestureData.Broadcast(GestureRecognizer->getOutcomes());
 	}
 }
 
@@ -51,6 +98,7 @@ void UVRGestureRecognitionComponent::TickComponent( float DeltaTime, ELevelTick
 void UVRGestureRecognitionComponent::RecordGesture(int32 GestureID)
 {
 	UE_LOG(VRGesturePluginLog, Log, TEXT("RecordGesture Starting recording gesture with ID: %d"), GestureID);
+	Pipeline.Reset();
 	GestureRecognizer->StartRecordingNewGesture(GestureID);
 }
 
@@ -60,19 +108,53 @@ void UVRGestureRecognitionComponent::StopRecordGesture()
 	UE_LOG(VRGesturePluginLog, Log, TEXT("[%s::StopRecordGesture]"), *GetName());
 }
 
+FVRGestureSimplifyReport UVRGestureRecognitionComponent::GetLastSimplifyReport()
+{
+	return GestureRecognizer ? GestureRecognizer->getLastSimplifyReport() : FVRGestureSimplifyReport();
+}
+
 void UVRGestureRecognitionComponent::ClearGestures()
 {
 	GestureRecognizer->ClearAllGestures();
 }
 
+bool UVRGestureRecognitionComponent::AddGesture(UVRGestureTemplate* GestureTemplate)
+{
+	return GestureRecognizer ? GestureRecognizer->addGestureTemplate(GestureTemplate) : false;
+}
+
+bool UVRGestureRecognitionComponent::RemoveGesture(int32 GestureID)
+{
+	return GestureRecognizer ? GestureRecognizer->removeGestureTemplate(GestureID) : false;
+}
+
+bool UVRGestureRecognitionComponent::SetSharedTemplates(UVRGestureTemplateManager* Templates)
+{
+	if (!GestureRecognizer || !GestureRecognizer->setTemplateLibrary(Templates))
+		return false;
+
+	SharedTemplates = Templates;
+	return true;
+}
+
+void UVRGestureRecognitionComponent::AddStreamPacket(const TArray<uint8>& Packet)
+{
+	if (GestureRecognizer)
+		StreamDecoder.DecodeToRecognizer(Packet, GestureRecognizer);
+}
+
 void UVRGestureRecognitionComponent::ListenGestures(TArray<int> GestureIDs)
 {
+	Pipeline.Reset();
+	StreamDecoder.Reset();
 	GestureRecognizer->StartListening(GestureIDs);
 }
 
 
 void UVRGestureRecognitionComponent::ListenAllGestures()
 {
+	Pipeline.Reset();
+	StreamDecoder.Reset();
 	GestureRecognizer->StartListening();
 }
 
@@ -81,6 +163,81 @@ void UVRGestureRecognitionComponent::StopListenGesture()
 	GestureRecognizer->StopListening();
 }
 
+void UVRGestureRecognitionComponent::AddFeatureSample(const TArray<float>& Features, float DeltaTime)
+{
+	if (GestureRecognizer)
+	{
+		GestureRecognizer->TickFeatures(Features.GetData(), Features.Num(), DeltaTime);
+	}
+}
+
+void UVRGestureRecognitionComponent::SetMotionGate(const FVRGestureMotionGate& Gate)
+{
+	MotionGate = Gate;
+	if (GestureRecognizer)
+	{
+		GestureRecognizer->setMotionGate(MotionGate);
+	}
+}
+
+int32 UVRGestureRecognitionComponent::AddProgressTrigger(const FVRGestureProgressTrigger& Trigger)
+{
+	return GestureRecognizer ? GestureRecognizer->addProgressTrigger(Trigger) : INDEX_NONE;
+}
+
+bool UVRGestureRecognitionComponent::RemoveProgressTrigger(int32 TriggerHandle)
+{
+	return GestureRecognizer && GestureRecognizer->removeProgressTrigger(TriggerHandle);
+}
+
+void UVRGestureRecognitionComponent::SetOutcomePublishing(const FVRGestureOutcomePublishing& Publishing)
+{
+	OutcomePublishing = Publishing;
+	if (GestureRecognizer)
+	{
+		GestureRecognizer->setOutcomePublishing(OutcomePublishing);
+	}
+}
+
+void UVRGestureRecognitionComponent::SetInputPipeline(const FVRGestureInputPipelineConfig& Config)
+{
+	InputPipeline = Config;
+	Pipeline.SetConfig(InputPipeline);
+}
+
+void UVRGestureRecognitionComponent::SetRelevance(float NewRelevance)
+{
+	Relevance = NewRelevance;
+	UpdateLOD();
+
+	if (GestureRecognizer)
+	{
+		GestureRecognizer->setBudgetPriority(Relevance);
+	}
+}
+
+void UVRGestureRecognitionComponent::UpdateLOD()
+{
+	if (!GestureRecognizer || LODLevels.Num() == 0)
+		return;
+
+	int32 NewLOD = LODLevels.Num() - 1;
+	for (int32 Level = 0; Level < LODLevels.Num(); Level++)
+	{
+		if (Relevance >= LODLevels[Level].MinRelevance)
+		{
+			NewLOD = Level;
+			break;
+		}
+	}
+
+	if (NewLOD != CurrentLOD)
+	{
+		CurrentLOD = NewLOD;
+		GestureRecognizer->applyLOD(LODLevels[CurrentLOD]);
+	}
+}
+
 void UVRGestureRecognitionComponent::SaveTemplates()
 {
 	if (GestureRecognizer)
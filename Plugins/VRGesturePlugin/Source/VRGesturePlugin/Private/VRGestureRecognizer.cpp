@@ -4,8 +4,35 @@
 #include "VRGestureRecognizer.h"
 #include <algorithm>
 #include "RandomNumbers.h"
+#include "VRGestureBudgetScheduler.h"
+#include "ParallelFor.h"
 
-RandomNumbers RN; 
+DECLARE_CYCLE_STAT(TEXT("Recognizer TickListening"), STAT_VRGestureTickListening, STATGROUP_VRGesture);
+
+#if VRGESTURE_ALLOCATION_AUDIT
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tick allocations"), STAT_VRGestureTickAllocations, STATGROUP_VRGesture);
+
+static TAutoConsoleVariable<int32> CVarVRGestureAllocationAudit(
+	TEXT("vrgesture.AllocationAudit"),
+	0,
+	TEXT("Check that listening recognizers do not grow their working memory once warmed up.\n")
+	TEXT("0: off, 1: log every growth, 2: ensure on every growth"),
+	ECVF_Default);
+
+// Listening ticks after train() before growths are reported
+static const int32 AllocationAuditWarmupTicks = 16;
+#endif
+
+// Particles per block of the resampler and of the deterministic update. Fixed, so that the
+// sums and the random streams do not depend on the threads
+static const int32 ParticleBlockSize = 4096;
+
+// Below this count the particle blocks run on the calling thread
+static const int32 ParallelMinParticles = 4 * ParticleBlockSize;
+
+// Snapshot header, the version changes whenever the layout changes
+static const uint32 SnapshotMagic = 0x53475256;    // "VRGS"
+static const uint32 SnapshotVersion = 8;
 
 //--------------------------------------------------------------
 UVRGestureRecognizer::UVRGestureRecognizer(const FObjectInitializer& X)
@@ -13,12 +40,17 @@ UVRGestureRecognizer::UVRGestureRecognizer(const FObjectInitializer& X)
 {
 
 	GestureManager = X.CreateDefaultSubobject<UVRGestureTemplateManager>(this, "GestureManager");
+	OwnedGestureManager = GestureManager;
 
-	CurrentGesture = X.CreateDefaultSubobject<UVRGestureTemplate>(this, "DefaultGesture");
+	ListeningGesture = X.CreateDefaultSubobject<UVRGestureTemplate>(this, "DefaultGesture");
+	CurrentGesture = ListeningGesture;
 
 	RecognizerConfig.Dimensions = 3;
 	RecognizerConfig.bTranslate = true;
 	RecognizerConfig.bSegmentation = false;
+	RecognizerConfig.bDataDrivenProposals = false;
+	RecognizerConfig.ProposalRatio = 0.5f;
+	RecognizerConfig.FixedRate = 0.0f;
 
 	// default numberParticles is 1000, note that the computational cost directly depends on the number of particles
 	EngineParameters.numberParticles = 1000;
@@ -50,16 +82,59 @@ UVRGestureRecognizer::UVRGestureRecognizer(const FObjectInitializer& X)
 	EngineParameters.scalingsSpreadingRange = 0.3;
 	EngineParameters.rotationsSpreadingCenter = 0.0;
 	EngineParameters.rotationsSpreadingRange = 0.0;
+	EngineParameters.bFastLikelihood = false;
+	EngineParameters.bLogWeights = false;
 
 	tolerancesetmanually = false;
-
-	RN = RandomNumbers(); 
+	mostProbableIndex = INDEX_NONE;
+	featureKernel = nullptr;
+	minRange = FVector(INFINITY);
+	maxRange = FVector(-INFINITY);
+	timeSincePublish = 0.0f;
+	bOutcomesDirty = false;
+	listeningHistoryCapacity = 256;
+	auditedTicks = 0;
+	auditedAllocations = 0;
+	updateLikelihoodConstants();
+	updateInterval = 1;
+	nextProgressTriggerHandle = 0;
+	bDeterministic = false;
+	deterministicSeed = 0;
+	deterministicUpdates = 0;
+	bFeatureInput = false;
+	FMemory::Memzero(lastInputFeature);
+	samplesSinceUpdate = 0;
+	timeSinceUpdate = 0.0f;
+	recordingTime = 0.0f;
+
+	requestedNumberParticles = EngineParameters.numberParticles;
+	budgetThrottle = 0;
+	budgetPriority = 1.0f;
+	frameCostCycles = 0;
+	averageFrameCostUs = 0.0f;
+	bBudgetManaged = true;
+	resetMotionGate();
 }
 
 //--------------------------------------------------------------
+void UVRGestureRecognizer::BeginDestroy()
+{
+	if (state == EVRGestureRecognizerState::Listening && bBudgetManaged)
+		FVRGestureBudgetScheduler::Get().Unregister(this);
+	Super::BeginDestroy();
+}
 
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::train() {
 
-void UVRGestureRecognizer::train() {
+	// every template is compared with the kernel of one feature dimension
+	if (!GestureManager->HasUniformFeatureDimensions())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::train] Templates have different feature dimensions, cannot train"), *GetName());
+		featureKernel = nullptr;
+		GestureParticles.Reset();
+		return false;
+	}
 
 	if (GestureManager->GestureTemplates.Num() > 0)
 	{
@@ -71,12 +146,116 @@ void UVRGestureRecognizer::train() {
 		else if (RecognizerConfig.Dimensions == 3) rotationsDim = 3;
 		else rotationsDim = 0;
 
-		GestureParticles.SetNumUninitialized(EngineParameters.numberParticles);
+		// feature templates are compared with the kernel instantiated for their dimension
+		int32 FeatureDimensions = GestureManager->GestureTemplates.CreateConstIterator().Value()->featureDimensions;
+		featureKernel = FeatureDimensions > 0 ? GetDistanceKernel(FeatureDimensions) : nullptr;
+		while (featureWeights.Num() < FeatureDimensions)
+			featureWeights.Add(1.0f);
+
+		GestureParticles.SetNumUninitialized(EngineParameters.numberParticles, false);
+		reserveWorkspace();
+		initEstimates();
 
 		initPrior();            // prior on init state values
 		initNoiseParameters();  // init noise parameters (transition and likelihood)
+		updateLikelihoodConstants();
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Size the working memory for the current templates and particles, so that
+// listening does not allocate once started
+void UVRGestureRecognizer::reserveWorkspace()
+{
+	int32 MaxParticles = FMath::Max(EngineParameters.numberParticles, requestedNumberParticles);
+	int32 NumTemplates = GestureManager->GestureTemplates.Num();
+
+	GestureParticles.Reserve(MaxParticles);
+	resampleScratch.Reserve(MaxParticles);
+	resampleCumulative.Reserve(MaxParticles);
+	resampleBlockSums.Reserve(FMath::DivideAndRoundUp(MaxParticles, ParticleBlockSize));
+	tickBlockSums.Reserve(FMath::DivideAndRoundUp(MaxParticles, ParticleBlockSize));
+
+	listenedGestureIDs.Reserve(NumTemplates);
+	candidateGestureIDs.Reserve(NumTemplates);
+	prefilterCosts.Reserve(NumTemplates);
+	coarseScratch.Reserve(FMath::Max(Prefilter.TemplateDirections, 1));
+	windowDirections.Reserve(FMath::Max(Prefilter.WindowDirections, 1));
+	dtwRow.Reserve(FMath::Max(Prefilter.TemplateDirections, 1) * 2);
+	Outcomes.Gestures.Reserve(NumTemplates);
+	publishedOutcomes.Reserve(NumTemplates);
+
+	// the listening history covers the longest gesture twice, and the prefilter window
+	listeningHistoryCapacity = FMath::Max3(2 * getLongestTemplateLength(), 2 * Prefilter.WindowSize, 64);
+	ListeningGesture->reserve(listeningHistoryCapacity, getFeatureInputDimensions());
+
+	auditedTicks = 0;
+}
+
+//--------------------------------------------------------------
+int32 UVRGestureRecognizer::getLongestTemplateLength()
+{
+	int32 Longest = 0;
+	for (auto& Elem : GestureManager->GestureTemplates)
+	{
+		Longest = FMath::Max(Longest, Elem.Value->getTemplateLength());
+	}
+	return Longest;
+}
+
+//--------------------------------------------------------------
+int32 UVRGestureRecognizer::getAuditedAllocations()
+{
+	return auditedAllocations;
+}
+
+#if VRGESTURE_ALLOCATION_AUDIT
+//--------------------------------------------------------------
+// Heap memory held by the per tick working memory. Any heap allocation of the
+// listening path goes through one of these arrays, so a change means an allocation
+SIZE_T UVRGestureRecognizer::getWorkingMemorySize()
+{
+	SIZE_T Size = GestureParticles.GetAllocatedSize()
+		+ resampleScratch.GetAllocatedSize()
+		+ resampleCumulative.GetAllocatedSize()
+		+ resampleBlockSums.GetAllocatedSize()
+		+ tickBlockSums.GetAllocatedSize()
+		+ candidateGestureIDs.GetAllocatedSize()
+		+ prefilterCosts.GetAllocatedSize()
+		+ coarseScratch.GetAllocatedSize()
+		+ windowDirections.GetAllocatedSize()
+		+ dtwRow.GetAllocatedSize()
+		+ Outcomes.Gestures.GetAllocatedSize()
+		+ publishedOutcomes.GetAllocatedSize();
+
+	if (CurrentGesture)
+	{
+		Size += CurrentGesture->templateRaw.GetAllocatedSize()
+			+ CurrentGesture->templateQuantised.GetAllocatedSize()
+			+ CurrentGesture->templateFeatures.GetAllocatedSize();
 	}
+	return Size;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::auditAllocations(SIZE_T SizeBefore)
+{
+	// recognizers also run on worker threads (auto tuner)
+	int32 AuditMode = CVarVRGestureAllocationAudit.GetValueOnAnyThread();
+	if (AuditMode == 0 || ++auditedTicks <= AllocationAuditWarmupTicks)
+		return;
+
+	SIZE_T SizeAfter = getWorkingMemorySize();
+	if (SizeAfter == SizeBefore)
+		return;
+
+	auditedAllocations++;
+	INC_DWORD_STAT(STAT_VRGestureTickAllocations);
+	UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::Tick] Working memory changed from %u to %u bytes after warm up"), *GetName(), (uint32)SizeBefore, (uint32)SizeAfter);
+	ensureMsgf(AuditMode < 2, TEXT("Gesture recognizer allocated while listening"));
 }
+#endif
 
 void UVRGestureRecognizer::StartRecordingNewGesture(int32 GestureID)
 {
@@ -87,6 +266,12 @@ void UVRGestureRecognizer::StartRecordingNewGesture(int32 GestureID)
 		return;
 	}
 
+	if (GestureManager->IsReadOnly())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::StartRecordingNewGesture] Cannot start, the template library is shared and read-only."), *GetName());
+		return;
+	}
+
 	// Check if the new gesture ID is valid
 	if (!GestureManager->IsValidGestureID(GestureID))
 	{
@@ -94,10 +279,12 @@ void UVRGestureRecognizer::StartRecordingNewGesture(int32 GestureID)
 		return;
 	}
 
-	// Create new gesture template and set as current
+	// Create new gesture template and set as current, it is handed to the template manager when the recording stops
 	CurrentGesture = NewObject<UVRGestureTemplate>();
 	CurrentGesture->GestureID = GestureID;
-
+	CurrentGesture->reserve(FMath::Max(getLongestTemplateLength(), 128), getFeatureInputDimensions());
+	recordingTime = 0.0f;
+	fixedRateResampler.Reset();
 
 	state = EVRGestureRecognizerState::Recording;
 }
@@ -111,47 +298,265 @@ void UVRGestureRecognizer::StopRecordingGesture()
 		return;
 	}
 
-	if (!GestureManager->AddNewGesture(CurrentGesture))
+	// rate of the recorded samples, simplification keeps the duration in recorded samples
+	CurrentGesture->templateSampleRate = recordingTime > 0.0f ? CurrentGesture->getTemplateLength() / recordingTime : 0.0f;
+
+	if (Simplification.bEnabled)
+	{
+		lastSimplifyReport = CurrentGesture->simplify(Simplification.IdleDistance, Simplification.Tolerance);
+		UE_LOG(VRGesturePluginLog, Log, TEXT("[%s::StopRecordingGesture] Simplified gesture %d from %d to %d samples (trimmed %d + %d idle), compression x%.2f"), *GetName(), CurrentGesture->GestureID,
+			lastSimplifyReport.RecordedLength, lastSimplifyReport.SimplifiedLength, lastSimplifyReport.TrimmedHead, lastSimplifyReport.TrimmedTail, lastSimplifyReport.CompressionRatio);
+	}
+
+	// the particles are initialised by the next StartListening, no need to train here
+	if (!addGestureTemplate(CurrentGesture))
 	{
 		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::StopRecordingGesture] Failed to add new gesture to gesture manager."), *GetName());
 	}
 	else
 	{
-		minRange = FVector(INFINITY, INFINITY, INFINITY);
-		maxRange = FVector(-INFINITY, -INFINITY, -INFINITY);
+		CurrentGesture = nullptr; 
+	}
 
-		// compute min/max from the data
-		for (auto& Elem : GestureManager->GestureTemplates)
-		{
-			FVector& tMinRange = Elem.Value->getMinRange();
-			FVector& tMaxRange = Elem.Value->getMaxRange();
+	// templates changed, candidates are selected again at the next StartListening
+	listenedGestureIDs.Reset();
+	candidateGestureIDs.Reset();
+
+	state = EVRGestureRecognizerState::Idle;
+}
+
+void UVRGestureRecognizer::ClearAllGestures()
+{
+	// a shared library is not cleared, the recognizer goes back to its own one
+	if (OwnedGestureManager->IsReadOnly())
+		OwnedGestureManager = NewObject<UVRGestureTemplateManager>(this);
+	GestureManager = OwnedGestureManager;
+	GestureManager->clear(); 
+	GestureEstimates.Reset();
+	listenedGestureIDs.Reset();
+	candidateGestureIDs.Reset();
+	minRange = FVector(INFINITY);
+	maxRange = FVector(-INFINITY);
+}
+
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::addGestureTemplate(UVRGestureTemplate* GestureTemplate)
+{
+	if (GestureTemplate == nullptr || GestureTemplate->getTemplateLength() == 0)
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::addGestureTemplate] Cannot add an empty template."), *GetName());
+		return false;
+	}
 
-			if (tMinRange.X < minRange.X) minRange.X = tMinRange.X;
-			if (tMinRange.Y < minRange.Y) minRange.Y = tMinRange.Y;
-			if (tMinRange.Z < minRange.Z) minRange.Z = tMinRange.Z;
+	if (GestureManager->IsReadOnly())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::addGestureTemplate] The template library is shared and read-only."), *GetName());
+		return false;
+	}
 
-			if (tMaxRange.X > maxRange.X) maxRange.X = tMaxRange.X;
-			if (tMaxRange.Y > maxRange.Y) maxRange.Y = tMaxRange.Y;
-			if (tMaxRange.Z > maxRange.Z) maxRange.Z = tMaxRange.Z;
+	// every template of the library is compared with the same kernel
+	if (GestureManager->GestureTemplates.Num() > 0)
+	{
+		int32 FeatureDimensions = GestureManager->GestureTemplates.CreateConstIterator().Value()->featureDimensions;
+		if (GestureTemplate->featureDimensions != FeatureDimensions)
+		{
+			UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::addGestureTemplate] Gesture %d has %d feature dimensions, expected %d"), *GetName(), GestureTemplate->GestureID, GestureTemplate->featureDimensions, FeatureDimensions);
+			return false;
 		}
+	}
 
-		for (auto& Elem : GestureManager->GestureTemplates)
+	if (!GestureManager->AddNewGesture(GestureTemplate))
+		return false;
+
+	if (!GestureTemplate->hasSampleRange())
+		GestureTemplate->computeSampleRange();
+
+	// only the new template is normalised, unless it widens the range of the library
+	applyRange(extendRange(GestureTemplate) ? nullptr : GestureTemplate);
+
+	if (state == EVRGestureRecognizerState::Listening)
+	{
+		listenedGestureIDs.Add(GestureTemplate->GestureID);
+		candidateGestureIDs.AddUnique(GestureTemplate->GestureID);
+		reserveWorkspace();
+		initEstimates();
+		initNoiseParameters();
+		updateLikelihoodConstants();
+		respreadParticles(GestureTemplate->GestureID, INDEX_NONE);
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::removeGestureTemplate(int32 GestureID)
+{
+	UVRGestureTemplate** Found = GestureManager->GestureTemplates.Find(GestureID);
+	if (Found == nullptr || GestureManager->IsReadOnly())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::removeGestureTemplate] Gesture %d not found or library read-only."), *GetName(), GestureID);
+		return false;
+	}
+
+	UVRGestureTemplate* GestureTemplate = *Found;
+	GestureManager->deleteTemplate(GestureID);
+	GestureEstimates.Remove(GestureID);
+
+	if (GestureManager->GestureTemplates.Num() == 0)
+	{
+		minRange = FVector(INFINITY);
+		maxRange = FVector(-INFINITY);
+	}
+	else if (shrinkRange(GestureTemplate))
+	{
+		applyRange(nullptr);
+	}
+
+	listenedGestureIDs.Remove(GestureID);
+	candidateGestureIDs.Remove(GestureID);
+
+	if (state == EVRGestureRecognizerState::Listening)
+	{
+		if (listenedGestureIDs.Num() == 0)
 		{
-			Elem.Value->setMinRange(minRange);
-			Elem.Value->setMaxRange(maxRange);
+			StopListening();
+			return true;
 		}
 
-		train();
+		if (candidateGestureIDs.Num() == 0)
+			candidateGestureIDs = listenedGestureIDs;
 
-		CurrentGesture = nullptr; 
+		initNoiseParameters();
+		updateLikelihoodConstants();
+		respreadParticles(INDEX_NONE, GestureID);
+		if (mostProbableIndex == GestureID)
+			mostProbableIndex = INDEX_NONE;
 	}
+	return true;
+}
 
-	state = EVRGestureRecognizerState::Idle;
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::setTemplateLibrary(UVRGestureTemplateManager* Library)
+{
+	if (state != EVRGestureRecognizerState::Idle)
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::setTemplateLibrary] Cannot change the library, current state is different from idle. State=%s"), *GetName(), *GetEnumValueToString("EVRGestureRecognizerState", state));
+		return false;
+	}
+
+	if (Library == nullptr)
+		Library = OwnedGestureManager;
+
+	if (!Library->HasUniformFeatureDimensions())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::setTemplateLibrary] The templates of the library have different feature dimensions."), *GetName());
+		return false;
+	}
+
+	// the derived data is built once, by the first recognizer sharing the library
+	if (Library != OwnedGestureManager && !Library->IsReadOnly() && !Library->Freeze(Prefilter.TemplateDirections))
+		return false;
+
+	GestureManager = Library;
+	recomputeRange();
+	listenedGestureIDs.Reset();
+	candidateGestureIDs.Reset();
+	GestureEstimates.Reset();
+	initEstimates();
+	return true;
 }
 
-void UVRGestureRecognizer::ClearAllGestures()
+//--------------------------------------------------------------
+UVRGestureTemplateManager* UVRGestureRecognizer::getTemplateLibrary()
 {
-	GestureManager->clear(); 
+	return GestureManager;
+}
+
+//--------------------------------------------------------------
+// One estimate per template. Done when templates change, estimates() only resets them
+void UVRGestureRecognizer::initEstimates()
+{
+	for (auto It = GestureEstimates.CreateIterator(); It; ++It)
+	{
+		if (!GestureManager->GestureTemplates.Contains(It.Key()))
+			It.RemoveCurrent();
+	}
+
+	for (auto& Elem : GestureManager->GestureTemplates)
+	{
+		GestureEstimates.FindOrAdd(Elem.Key).Reset();
+	}
+}
+
+//--------------------------------------------------------------
+// Extend the library range with the samples of a new template
+// @return true if the range changed, every template must then be normalised again
+bool UVRGestureRecognizer::extendRange(UVRGestureTemplate* GestureTemplate)
+{
+	// first template, or templates stored without going through addGestureTemplate
+	if (minRange.X > maxRange.X || GestureManager->GestureTemplates.Num() == 1)
+	{
+		recomputeRange();
+		return true;
+	}
+
+	FVector NewMin = minRange.ComponentMin(GestureTemplate->sampleRangeMin);
+	FVector NewMax = maxRange.ComponentMax(GestureTemplate->sampleRangeMax);
+	if (NewMin == minRange && NewMax == maxRange)
+		return false;
+
+	minRange = NewMin;
+	maxRange = NewMax;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Update the library range after a template removal
+// @return true if the range changed, every template must then be normalised again
+bool UVRGestureRecognizer::shrinkRange(UVRGestureTemplate* GestureTemplate)
+{
+	// the range only shrinks if the removed template was on one of its bounds
+	const FVector& SampleMin = GestureTemplate->sampleRangeMin;
+	const FVector& SampleMax = GestureTemplate->sampleRangeMax;
+	if (SampleMin.X > minRange.X && SampleMin.Y > minRange.Y && SampleMin.Z > minRange.Z
+		&& SampleMax.X < maxRange.X && SampleMax.Y < maxRange.Y && SampleMax.Z < maxRange.Z)
+		return false;
+
+	FVector OldMin = minRange;
+	FVector OldMax = maxRange;
+	recomputeRange();
+	return OldMin != minRange || OldMax != maxRange;
+}
+
+//--------------------------------------------------------------
+// Library range from the extent of each template, no sample is read
+void UVRGestureRecognizer::recomputeRange()
+{
+	minRange = FVector(INFINITY);
+	maxRange = FVector(-INFINITY);
+	for (auto& Elem : GestureManager->GestureTemplates)
+	{
+		if (!Elem.Value->hasSampleRange())
+			Elem.Value->computeSampleRange();
+
+		minRange = minRange.ComponentMin(Elem.Value->sampleRangeMin);
+		maxRange = maxRange.ComponentMax(Elem.Value->sampleRangeMax);
+	}
+}
+
+//--------------------------------------------------------------
+// Give the library range to one template, or to every template if nullptr
+void UVRGestureRecognizer::applyRange(UVRGestureTemplate* GestureTemplate)
+{
+	if (GestureTemplate)
+	{
+		GestureTemplate->setRange(minRange, maxRange);
+		return;
+	}
+
+	for (auto& Elem : GestureManager->GestureTemplates)
+	{
+		Elem.Value->setRange(minRange, maxRange);
+	}
 }
 
 void UVRGestureRecognizer::StartListening(TArray<int32> GestureIDs /*= TArray<int32>()*/)
@@ -177,15 +582,48 @@ void UVRGestureRecognizer::StartListening(TArray<int32> GestureIDs /*= TArray<in
 		GestureIDs = GestureManager->GetAllGestureIDs();
 	}
 
-	// Create dummy template to listen 
-	if (CurrentGesture == NULL)
+	listenedGestureIDs.Reset();
+	for (int32 GestureID : GestureIDs)
 	{
-		CurrentGesture = NewObject<UVRGestureTemplate>();
+		if (GestureManager->GestureTemplates.Contains(GestureID))
+			listenedGestureIDs.Add(GestureID);
 	}
+	candidateGestureIDs = listenedGestureIDs;
 
-	train();
+	// The listening template is reused by every listening session
+	CurrentGesture = ListeningGesture;
+
+	// deterministic: every session replays from the same seed, initial spread included
+	if (bDeterministic)
+	{
+		RN.SetSeed(deterministicSeed);
+		deterministicUpdates = 0;
+	}
+
+	if (!train())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::StartListening] Cannot start, the templates have different feature dimensions."), *GetName());
+		return;
+	}
 	state = EVRGestureRecognizerState::Listening;
 	CurrentGesture->Reset();
+	resetMotionGate();
+	fixedRateResampler.Reset();
+	samplesSinceUpdate = 0;
+	timeSinceUpdate = 0.0f;
+	auditedTicks = 0;
+	mostProbableIndex = INDEX_NONE;
+	publishedOutcomes.Reset();
+	bOutcomesDirty = false;
+	timeSincePublish = 0.0f;
+	for (FProgressTriggerState& State : progressTriggers)
+	{
+		State.NumReached = 0;
+	}
+
+	// deterministic recognizers keep the particle count and update interval they were given
+	if (bBudgetManaged && !bDeterministic)
+		FVRGestureBudgetScheduler::Get().Register(this);
 }
 
 void UVRGestureRecognizer::StopListening()
@@ -199,21 +637,106 @@ void UVRGestureRecognizer::StopListening()
 
 	state = EVRGestureRecognizerState::Idle;
 	CurrentGesture->Reset();
+	resetMotionGate();
+
+	if (bBudgetManaged)
+		FVRGestureBudgetScheduler::Get().Unregister(this);
+	setBudgetThrottle(0);
+	averageFrameCostUs = 0.0f;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::Tick(FVector& InputPoint, float DeltaTime)
+{
+	// fixed rate: the filter sees the same sample rate whatever the frame rate
+	if (RecognizerConfig.FixedRate > 0.0f && DeltaTime > 0.0f && state != EVRGestureRecognizerState::Idle)
+	{
+		FVector Samples[FVRGestureInputPipeline::MaxOutputsPerSample];
+		float SampleDeltaTimes[FVRGestureInputPipeline::MaxOutputsPerSample];
+		int32 NumDropped = 0;
+		int32 NumSamples = fixedRateResampler.ProcessBlock(&InputPoint, 1, DeltaTime, Samples, SampleDeltaTimes, FVRGestureInputPipeline::MaxOutputsPerSample, &NumDropped);
+		for (int32 i = 0; i < NumSamples; i++)
+		{
+			addInput(Samples[i], nullptr, SampleDeltaTimes[i]);
+		}
+		if (NumDropped > 0)
+		{
+			UE_LOG(VRGesturePluginLog, Verbose, TEXT("[%s::Tick] Long frame (%.3f s), %d fixed rate samples dropped"), *GetName(), DeltaTime, NumDropped);
+		}
+		return;
+	}
+
+	addInput(InputPoint, nullptr, DeltaTime);
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::TickFeatures(const float* Feature, int32 NumDimensions, float DeltaTime)
+{
+	if (Feature == nullptr || NumDimensions != RecognizerConfig.Dimensions)
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::TickFeatures] Feature dimension %d does not match the recognizer dimension %d"), *GetName(), NumDimensions, RecognizerConfig.Dimensions);
+		return;
+	}
+
+	FVector InputPoint(Feature[0], NumDimensions > 1 ? Feature[1] : 0.0f, NumDimensions > 2 ? Feature[2] : 0.0f);
+	addInput(InputPoint, Feature, DeltaTime);
 }
 
 //--------------------------------------------------------------
-void UVRGestureRecognizer::Tick(FVector& InputPoint)
+// Common input path of positions (Feature is null) and N-D features
+void UVRGestureRecognizer::addInput(const FVector& InputPoint, const float* Feature, float DeltaTime)
 {
 	switch (state)
 	{
 	case EVRGestureRecognizerState::Listening:
-		CurrentGesture->addObservation(InputPoint);
-		// Update the estimation
-		TickListening();
+		if ((featureKernel != nullptr) != (Feature != nullptr))
+		{
+			UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::Tick] Input does not match the templates, use Tick for position templates and TickFeatures for feature templates"), *GetName());
+			break;
+		}
+		// Skip the whole update while the controller is still
+		if (!updateMotionGate(InputPoint, Feature, DeltaTime))
+			break;
+		{
+#if VRGESTURE_ALLOCATION_AUDIT
+			SIZE_T AuditedSize = getWorkingMemorySize();
+#endif
+			// only the recent input is used, the oldest half of a full history is dropped in place
+			if (CurrentGesture->getTemplateLength() >= listeningHistoryCapacity)
+				CurrentGesture->dropOldestSamples(listeningHistoryCapacity / 2);
+
+			if (Feature)
+				CurrentGesture->addFeatureObservation(Feature, RecognizerConfig.Dimensions);
+			else
+				CurrentGesture->addObservation(InputPoint);
+			if (RecognizerConfig.FixedRate > 0.0f)
+				timeSinceUpdate += DeltaTime > 0.0f ? DeltaTime : 1.0f / RecognizerConfig.FixedRate;
+
+			// Update the estimation, skipped samples are compensated in the dynamics
+			if (++samplesSinceUpdate >= getBudgetedUpdateInterval())
+			{
+				SCOPE_CYCLE_COUNTER(STAT_VRGestureTickListening);
+				uint32 StartCycles = FPlatformTime::Cycles();
+
+				// at a fixed rate the step is the elapsed time in samples of that rate
+				TickListening(RecognizerConfig.FixedRate > 0.0f ? timeSinceUpdate * RecognizerConfig.FixedRate : samplesSinceUpdate);
+				samplesSinceUpdate = 0;
+				timeSinceUpdate = 0.0f;
+
+				frameCostCycles += FPlatformTime::Cycles() - StartCycles;
+			}
+#if VRGESTURE_ALLOCATION_AUDIT
+			auditAllocations(AuditedSize);
+#endif
+		}
 		break;
 
 	case EVRGestureRecognizerState::Recording:
-		CurrentGesture->addObservation(InputPoint);
+		recordingTime += DeltaTime;
+		if (Feature)
+			CurrentGesture->addFeatureObservation(Feature, RecognizerConfig.Dimensions);
+		else
+			CurrentGesture->addObservation(InputPoint);
 		UE_LOG(VRGesturePluginLog, Log, TEXT("[%s::Tick] Recording - Added point: %s"), *GetName(), *InputPoint.ToString());
 		break;
 
@@ -223,61 +746,124 @@ void UVRGestureRecognizer::Tick(FVector& InputPoint)
 	}
 }
 
-void UVRGestureRecognizer::TickListening()
+void UVRGestureRecognizer::TickListening(float StepScale)
 {
 	FVector obs = CurrentGesture->getLastObservation();
 
+	if (Prefilter.bEnabled)
+		updateCandidates();
+
+	// random walk noise grows with the square root of the number of samples covered
+	float NoiseScale = FMath::Sqrt(StepScale);
+
 	// for each particle: perform updates of state space / likelihood / prior (weights)
-	float sumw = 0.0;
-	for (int ParticleIndex = 0; ParticleIndex < EngineParameters.numberParticles; ParticleIndex++)
+	// the options are resolved once here, the particle loop is instantiated for each combination
+	#define VRGESTURE_TICK_KERNEL(Index) &UVRGestureRecognizer::tickParticles<(Index & 1) != 0, (Index & 2) != 0, (Index & 4) != 0, (Index & 8) != 0>
+	static const FTickParticles TickKernels[16] =
 	{
-		if (!GestureParticles.IsValidIndex(ParticleIndex))
+		VRGESTURE_TICK_KERNEL(0), VRGESTURE_TICK_KERNEL(1), VRGESTURE_TICK_KERNEL(2), VRGESTURE_TICK_KERNEL(3),
+		VRGESTURE_TICK_KERNEL(4), VRGESTURE_TICK_KERNEL(5), VRGESTURE_TICK_KERNEL(6), VRGESTURE_TICK_KERNEL(7),
+		VRGESTURE_TICK_KERNEL(8), VRGESTURE_TICK_KERNEL(9), VRGESTURE_TICK_KERNEL(10), VRGESTURE_TICK_KERNEL(11),
+		VRGESTURE_TICK_KERNEL(12), VRGESTURE_TICK_KERNEL(13), VRGESTURE_TICK_KERNEL(14), VRGESTURE_TICK_KERNEL(15)
+	};
+	#undef VRGESTURE_TICK_KERNEL
+
+	int32 KernelIndex = (RecognizerConfig.bTranslate ? 1 : 0)
+		| (RecognizerConfig.bSegmentation ? 2 : 0)
+		| (rotationsDim != 0 ? 4 : 0)
+		| (EngineParameters.distribution == 0.0f ? 8 : 0);
+	FTickParticles TickKernel = TickKernels[KernelIndex];
+	int32 NumberOfParticles = FMath::Min(EngineParameters.numberParticles, GestureParticles.Num());
+
+	float sumw = 0.0f;
+	if (bDeterministic)
+	{
+		// fixed blocks, each drawing from its own stream of this update, partial sums added in
+		// block order: the same result on any number of threads
+		int32 NumBlocks = FMath::DivideAndRoundUp(NumberOfParticles, ParticleBlockSize);
+		bool bSingleThread = NumberOfParticles < ParallelMinParticles;
+		uint64 StreamBase = (uint64)deterministicUpdates++ << 24;
+		tickBlockSums.SetNumUninitialized(NumBlocks, false);
+
+		// the spatial index is built lazily, not from the workers
+		if (!bSingleThread && RecognizerConfig.bDataDrivenProposals)
+			GestureManager->UpdateSpatialIndex();
+
+		ParallelFor(NumBlocks, [&](int32 Block)
 		{
-			// TODO ERROR
-			continue;
-		}
-		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+			RandomNumbers BlockRandom(deterministicSeed, StreamBase + Block);
+			int32 First = Block * ParticleBlockSize;
+			int32 Last = FMath::Min(First + ParticleBlockSize, NumberOfParticles);
+			tickBlockSums[Block] = (this->*TickKernel)(obs, StepScale, NoiseScale, First, Last, BlockRandom);
+		}, bSingleThread);
 
-
-		for (int m = 0; m < EngineParameters.predictionSteps; m++)
+		for (int32 Block = 0; Block < NumBlocks; Block++)
 		{
-			updatePrior(Particle);
-			updateLikelihood(obs, Particle, ParticleIndex);
-			updatePosterior(Particle);
+			sumw += tickBlockSums[Block];
 		}
-
-		sumw += Particle->Posterior;   // sum posterior to normalise the distribution afterwards
+	}
+	else
+	{
+		sumw = (this->*TickKernel)(obs, StepScale, NoiseScale, 0, NumberOfParticles, RN);
 	}
 
 	// normalize the weights and compute the re sampling criterion
 	float dotProdw = 0.0;
-	for (int ParticleIndex = 0; ParticleIndex < EngineParameters.numberParticles; ParticleIndex++) {
+	if (EngineParameters.bLogWeights)
+	{
+		dotProdw = normaliseLogWeights();
+	}
+	else
+	{
+		for (int ParticleIndex = 0; ParticleIndex < EngineParameters.numberParticles; ParticleIndex++) {
 
-		if (!GestureParticles.IsValidIndex(ParticleIndex))
-		{
-			// TODO ERROR
-			continue;
-		}
-		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+			if (!GestureParticles.IsValidIndex(ParticleIndex))
+			{
+				// TODO ERROR
+				continue;
+			}
+			FGestureParticle* Particle = &GestureParticles[ParticleIndex];
 
-		Particle->Posterior /= sumw;
-		dotProdw += Particle->Posterior * Particle->Posterior;
+			Particle->Posterior /= sumw;
+			dotProdw += Particle->Posterior * Particle->Posterior;
+		}
 	}
 	// avoid degeneracy (no particles active, i.e. weight = 0) by re sampling
-	if ((1. / dotProdw) < EngineParameters.resamplingThreshold)
+	float ESS = 1. / dotProdw;
+	bool bResampled = ESS < EngineParameters.resamplingThreshold;
+	if (bResampled)
 		resampleAccordingToWeights(obs);
 
 	// estimate outcomes
 	// results are in every gesture templates objects 
 	estimates();
 
-	// Output estimates
-	//UE_LOG(VRGesturePluginLog, Log, TEXT("[%s::TickListening] Estimations"), *GetName());
-	for (auto& Elem : GestureManager->GestureTemplates)
+#if VRGESTURE_TELEMETRY
+	FVRGestureTelemetry::FScopedActive Telemetry;
+	if (Telemetry.Get())
+	{
+		recordTelemetry(Telemetry.Get(), ESS, bResampled);
+	}
+#endif
+}
+
+#if VRGESTURE_TELEMETRY
+//--------------------------------------------------------------
+void UVRGestureRecognizer::recordTelemetry(FVRGestureTelemetry* Telemetry, float ESS, bool bResampled)
+{
+	// posterior weighted histogram of the particle progressions
+	float ProgressionMass[FVRGestureTelemetry::NumProgressionBins] = { 0.0f };
+	int32 NumParticles = FMath::Min(EngineParameters.numberParticles, GestureParticles.Num());
+	for (int32 ParticleIndex = 0; ParticleIndex < NumParticles; ParticleIndex++)
 	{
-		//UE_LOG(VRGesturePluginLog, Log, TEXT("[%s::TickListening] #%d Likelihood:%f Progression:%f Scale: %s Rotation %s Dynamics %s"), *GetName(), Elem.Value->GestureID, Elem.Value->estimatedProbabilities, Elem.Value->estimatedAlignment, *Elem.Value->estimatedScalings.ToString(), *Elem.Value->estimatedRotations.ToString(), *Elem.Value->estimatedDynamics.ToString());
+		const FGestureParticle& Particle = GestureParticles[ParticleIndex];
+		int32 Bin = FMath::Clamp((int32)(Particle.Progression * FVRGestureTelemetry::NumProgressionBins), 0, FVRGestureTelemetry::NumProgressionBins - 1);
+		ProgressionMass[Bin] += Particle.Posterior;
 	}
+
+	Telemetry->Submit(GetUniqueID(), ESS, NumParticles, bResampled, GestureEstimates, ProgressionMass);
 }
+#endif
 
 
 
@@ -287,53 +873,349 @@ void UVRGestureRecognizer::TickListening()
 
 
 //--------------------------------------------------------------
-void UVRGestureRecognizer::initPrior()
+// Update the motion gate with a new input
+// @return true if the filter should be updated for this input
+bool UVRGestureRecognizer::updateMotionGate(const FVector& InputPoint, const float* Feature, float DeltaTime)
 {
-	for (int ParticleIndex = 0; ParticleIndex < EngineParameters.numberParticles; ParticleIndex++)
+	if (!MotionGate.bEnabled)
+		return true;
+
+	// feature input keeps its whole last sample, a wake restarts the history with it
+	const int32 NumFeatureDimensions = Feature ? RecognizerConfig.Dimensions : 0;
+
+	if (!bHasLastInput || DeltaTime <= 0.0f)
 	{
-		if (!GestureParticles.IsValidIndex(ParticleIndex))
-		{
-			// TODO ERROR
-			continue;
-		}
-		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+		lastInputPoint = InputPoint;
+		FMemory::Memcpy(lastInputFeature, Feature, NumFeatureDimensions * sizeof(float));
+		bHasLastInput = true;
+		return !bMotionGateAsleep;
+	}
 
-		Particle->Progression = (RN.GetRandomUniform() - 0.5) * EngineParameters.alignmentSpreadingRange + EngineParameters.alignmentSpreadingCenter;    // spread phase
+	float Speed = FVector::Dist(InputPoint, lastInputPoint) / DeltaTime;
+	FVector PreviousInput = lastInputPoint;
+	float PreviousFeature[VRGESTURE_MAX_FEATURE_DIMENSIONS];
+	FMemory::Memcpy(PreviousFeature, lastInputFeature, NumFeatureDimensions * sizeof(float));
+	lastInputPoint = InputPoint;
+	FMemory::Memcpy(lastInputFeature, Feature, NumFeatureDimensions * sizeof(float));
 
-																																					   // dynamics
-		Particle->Dynamic.X = (RN.GetRandomUniform() - 0.5) * EngineParameters.dynamicsSpreadingRange + EngineParameters.dynamicsSpreadingCenter; // spread speed
-		Particle->Dynamic.Y = (RN.GetRandomUniform() - 0.5) * EngineParameters.dynamicsSpreadingRange; // spread acceleration
+	if (bMotionGateAsleep)
+	{
+		if (Speed < MotionGate.WakeSpeed)
+			return false;
 
-																									 // scalings
-		Particle->Scale.X = (RN.GetRandomUniform() - 0.5) * EngineParameters.scalingsSpreadingRange + EngineParameters.scalingsSpreadingCenter; // spread scalings
-		Particle->Scale.Y = (RN.GetRandomUniform() - 0.5) * EngineParameters.scalingsSpreadingRange + EngineParameters.scalingsSpreadingCenter; // spread scalings
-		Particle->Scale.Z = (RN.GetRandomUniform() - 0.5) * EngineParameters.scalingsSpreadingRange + EngineParameters.scalingsSpreadingCenter; // spread scalings
+		bMotionGateAsleep = false;
+		motionGateStillTime = 0.0f;
 
-																																			  // rotations
-		if (rotationsDim != 0)
+		if (MotionGate.bResetOnWake)
 		{
-			Particle->Rotation.X = (RN.GetRandomUniform() - 0.5) * EngineParameters.rotationsSpreadingRange + EngineParameters.rotationsSpreadingCenter;    // spread rotations
-			Particle->Rotation.Y = (RN.GetRandomUniform() - 0.5) * EngineParameters.rotationsSpreadingRange + EngineParameters.rotationsSpreadingCenter;    // spread rotations
-			Particle->Rotation.Z = (RN.GetRandomUniform() - 0.5) * EngineParameters.rotationsSpreadingRange + EngineParameters.rotationsSpreadingCenter;    // spread rotations
+			// Start a new segment at the last still point
+			initPrior();
+			CurrentGesture->Reset();
+			if (Feature)
+				CurrentGesture->addFeatureObservation(PreviousFeature, NumFeatureDimensions);
+			else
+				CurrentGesture->addObservation(PreviousInput);
 		}
+		return true;
+	}
 
-		if (RecognizerConfig.bTranslate)
+	if (Speed < MotionGate.SleepSpeed)
+	{
+		motionGateStillTime += DeltaTime;
+		if (motionGateStillTime >= MotionGate.SleepDelay)
 		{
-			Particle->Offset.X = 0.0;
-			Particle->Offset.Y = 0.0;
-			Particle->Offset.Z = 0.0;
+			bMotionGateAsleep = true;
+			return false;
+		}
+	}
+	else
+	{
+		motionGateStillTime = 0.0f;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::resetMotionGate()
+{
+	bHasLastInput = false;
+	bMotionGateAsleep = false;
+	motionGateStillTime = 0.0f;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::initPrior()
+{
+	for (int ParticleIndex = 0; ParticleIndex < EngineParameters.numberParticles; ParticleIndex++)
+	{
+		if (!GestureParticles.IsValidIndex(ParticleIndex))
+		{
+			// TODO ERROR
+			continue;
+		}
+		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+
+		spreadParticle(Particle);
+
+		Particle->Prior = 1.0 / (float)EngineParameters.numberParticles;
+
+		// set the posterior to the prior at the initialization
+		Particle->Posterior = Particle->Prior;
+		Particle->LogPosterior = -FMath::Loge((float)EngineParameters.numberParticles);
+
+		// auto select a gesture id based on the one available 
+		Particle->GestureID = pickGestureID(ParticleIndex);
+		proposeParticle(Particle, RN);
+	}
+
+}
+
+//--------------------------------------------------------------
+// Draw the state of a particle from the initial spreads
+void UVRGestureRecognizer::spreadParticle(FGestureParticle* Particle)
+{
+	Particle->Progression = (RN.GetRandomUniform() - 0.5) * EngineParameters.alignmentSpreadingRange + EngineParameters.alignmentSpreadingCenter;    // spread phase
+
+																																				   // dynamics
+	Particle->Dynamic.X = (RN.GetRandomUniform() - 0.5) * EngineParameters.dynamicsSpreadingRange + EngineParameters.dynamicsSpreadingCenter; // spread speed
+	Particle->Dynamic.Y = (RN.GetRandomUniform() - 0.5) * EngineParameters.dynamicsSpreadingRange; // spread acceleration
+
+																								 // scalings
+	Particle->Scale.X = (RN.GetRandomUniform() - 0.5) * EngineParameters.scalingsSpreadingRange + EngineParameters.scalingsSpreadingCenter; // spread scalings
+	Particle->Scale.Y = (RN.GetRandomUniform() - 0.5) * EngineParameters.scalingsSpreadingRange + EngineParameters.scalingsSpreadingCenter; // spread scalings
+	Particle->Scale.Z = (RN.GetRandomUniform() - 0.5) * EngineParameters.scalingsSpreadingRange + EngineParameters.scalingsSpreadingCenter; // spread scalings
+
+																																		  // rotations
+	if (rotationsDim != 0)
+	{
+		Particle->Rotation.X = (RN.GetRandomUniform() - 0.5) * EngineParameters.rotationsSpreadingRange + EngineParameters.rotationsSpreadingCenter;    // spread rotations
+		Particle->Rotation.Y = (RN.GetRandomUniform() - 0.5) * EngineParameters.rotationsSpreadingRange + EngineParameters.rotationsSpreadingCenter;    // spread rotations
+		Particle->Rotation.Z = (RN.GetRandomUniform() - 0.5) * EngineParameters.rotationsSpreadingRange + EngineParameters.rotationsSpreadingCenter;    // spread rotations
+	}
+
+	if (RecognizerConfig.bTranslate)
+	{
+		Particle->Offset.X = 0.0;
+		Particle->Offset.Y = 0.0;
+		Particle->Offset.Z = 0.0;
+	}
+}
+
+//--------------------------------------------------------------
+// Re-spread a share of the particles while listening, without resetting the filter
+// @details the re-spread particles get the initial weight 1/N, the others keep their
+// relative weights and the distribution is normalised again
+// @param GestureID gesture of the re-spread particles, INDEX_NONE to pick among the candidates
+// @param RemovedGestureID re-spread the particles of this gesture, INDEX_NONE to re-spread
+// one particle out of the number of listened gestures (share of a new gesture)
+void UVRGestureRecognizer::respreadParticles(int32 GestureID, int32 RemovedGestureID)
+{
+	int NumberOfParticles = FMath::Min(EngineParameters.numberParticles, GestureParticles.Num());
+	if (NumberOfParticles == 0)
+		return;
+
+	int32 Stride = FMath::Max(listenedGestureIDs.Num(), 1);
+	float SpreadWeight = 1.0f / (float)NumberOfParticles;
+
+	float KeptWeight = 0.0f;
+	int32 NumSpread = 0;
+	for (int ParticleIndex = 0; ParticleIndex < NumberOfParticles; ParticleIndex++)
+	{
+		bool bSpread = RemovedGestureID != INDEX_NONE ? GestureParticles[ParticleIndex].GestureID == RemovedGestureID : (ParticleIndex % Stride) == Stride - 1;
+		if (bSpread)
+			NumSpread++;
+		else
+			KeptWeight += GestureParticles[ParticleIndex].Posterior;
+	}
+
+	float SumWeights = KeptWeight + NumSpread * SpreadWeight;
+	if (NumSpread == 0 || SumWeights <= 0.0f)
+		return;
+
+	float LogSumWeights = FMath::Loge(SumWeights);
+	for (int ParticleIndex = 0; ParticleIndex < NumberOfParticles; ParticleIndex++)
+	{
+		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+		bool bSpread = RemovedGestureID != INDEX_NONE ? Particle->GestureID == RemovedGestureID : (ParticleIndex % Stride) == Stride - 1;
+		if (!bSpread)
+		{
+			Particle->Posterior /= SumWeights;
+			Particle->LogPosterior -= LogSumWeights;
+			Particle->Prior = Particle->Posterior;
+			continue;
+		}
+
+		spreadParticle(Particle);
+		Particle->GestureID = GestureID != INDEX_NONE ? GestureID : pickGestureID(ParticleIndex);
+		Particle->Posterior = SpreadWeight / SumWeights;
+		Particle->LogPosterior = FMath::Loge(SpreadWeight) - LogSumWeights;
+		Particle->Prior = Particle->Posterior;
+		proposeParticle(Particle, RN);
+	}
+}
+//--------------------------------------------------------------
+// Round robin over the candidate gestures, or over every template if there are none
+int32 UVRGestureRecognizer::pickGestureID(int32 ParticleIndex)
+{
+	if (candidateGestureIDs.Num() > 0)
+		return candidateGestureIDs[ParticleIndex % candidateGestureIDs.Num()];
+
+	return GestureManager->GetGestureIDFromParticleIndex(ParticleIndex);
+}
+
+//--------------------------------------------------------------
+// Move a (re)spread particle near a template sample matching the current observation
+// @return true if the particle has been moved
+bool UVRGestureRecognizer::proposeParticle(FGestureParticle* Particle, RandomNumbers& Random)
+{
+	if (!RecognizerConfig.bDataDrivenProposals || state != EVRGestureRecognizerState::Listening
+		|| CurrentGesture == nullptr || CurrentGesture->getTemplateLength() == 0)
+		return false;
+
+	if (Random.GetRandomUniform() >= RecognizerConfig.ProposalRatio)
+		return false;
+
+	FVector obs = CurrentGesture->getLastObservation();
+	if (RecognizerConfig.bTranslate)
+		obs = obs - Particle->Offset;
+
+	return GestureManager->ProposeFromObservation(obs, candidateGestureIDs, Random.GetRandomUniform(), Particle->GestureID, Particle->Progression);
+}
+
+//--------------------------------------------------------------
+// Cascade stage: match the directions of the recent input against coarse template
+// directions (subsequence DTW, free start and end in the template) and keep the
+// best gestures as candidates for the particle filter
+void UVRGestureRecognizer::updateCandidates()
+{
+	TArray<FVector>& Observations = CurrentGesture->templateRaw;
+	int32 WindowSize = FMath::Max(Prefilter.WindowSize, 2);
+	int32 NumWindowDirections = FMath::Clamp(Prefilter.WindowDirections, 1, WindowSize - 1);
+	int32 NumTemplateDirections = FMath::Max(Prefilter.TemplateDirections, 1);
+
+	// the reserved capacity is kept, no allocation while listening
+	auto CandidateAll = [this]()
+	{
+		candidateGestureIDs.Reset();
+		candidateGestureIDs.Append(listenedGestureIDs);
+	};
+
+	// not enough input yet: every listened gesture is a candidate
+	if (Observations.Num() < WindowSize)
+	{
+		CandidateAll();
+		return;
+	}
+
+	int32 WindowStart = Observations.Num() - WindowSize;
+	float WindowPath = 0.0f;
+	windowDirections.SetNumUninitialized(NumWindowDirections);
+	for (int32 i = 0; i < NumWindowDirections; i++)
+	{
+		const FVector& From = Observations[WindowStart + i * (WindowSize - 1) / NumWindowDirections];
+		const FVector& To = Observations[WindowStart + (i + 1) * (WindowSize - 1) / NumWindowDirections];
+		WindowPath += FVector::Dist(From, To);
+		windowDirections[i] = (To - From).GetSafeNormal();
+	}
+
+	// directions of a still input are only noise
+	if (WindowPath < Prefilter.MinWindowPath)
+	{
+		CandidateAll();
+		return;
+	}
+
+	prefilterCosts.Reset();
+	dtwRow.SetNumUninitialized(NumTemplateDirections * 2);
+	for (int32 GestureID : listenedGestureIDs)
+	{
+		// a template removed while listening is never a candidate
+		UVRGestureTemplate** GestureTemplatePtr = GestureManager->GestureTemplates.Find(GestureID);
+		if (GestureTemplatePtr == nullptr)
+		{
+			prefilterCosts.Add(INFINITY);
+			continue;
+		}
+		UVRGestureTemplate* GestureTemplate = *GestureTemplatePtr;
+		const TArray<FVector>* TemplateDirectionsPtr = &GestureTemplate->coarseDirections;
+		if (GestureTemplate->coarseDirections.Num() != NumTemplateDirections)
+		{
+			// shared templates are read-only, other sizes go to the recognizer scratch
+			if (GestureManager->IsReadOnly())
+			{
+				GestureTemplate->buildCoarseDirections(NumTemplateDirections, coarseScratch);
+				TemplateDirectionsPtr = &coarseScratch;
+			}
+			else
+			{
+				GestureTemplate->buildCoarseDirections(NumTemplateDirections);
+			}
+		}
+		const TArray<FVector>& TemplateDirections = *TemplateDirectionsPtr;
+
+		// two rows of the DTW matrix, cost = 1 - cos(angle between directions)
+		float* Previous = dtwRow.GetData();
+		float* Current = Previous + NumTemplateDirections;
+		for (int32 j = 0; j < NumTemplateDirections; j++)
+			Previous[j] = 1.0f - FVector::DotProduct(windowDirections[0], TemplateDirections[j]);
+
+		for (int32 i = 1; i < NumWindowDirections; i++)
+		{
+			Current[0] = Previous[0] + 1.0f - FVector::DotProduct(windowDirections[i], TemplateDirections[0]);
+			for (int32 j = 1; j < NumTemplateDirections; j++)
+			{
+				float Best = FMath::Min3(Previous[j], Previous[j - 1], Current[j - 1]);
+				Current[j] = Best + 1.0f - FVector::DotProduct(windowDirections[i], TemplateDirections[j]);
+			}
+			Swap(Previous, Current);
+		}
+
+		float Cost = Previous[0];
+		for (int32 j = 1; j < NumTemplateDirections; j++)
+			Cost = FMath::Min(Cost, Previous[j]);
+
+		prefilterCosts.Add(Cost / NumWindowDirections);
+	}
+
+	// keep the best gestures within the margin
+	float BestCost = prefilterCosts.Num() > 0 ? FMath::Min(prefilterCosts) : INFINITY;
+	if (BestCost == INFINITY)
+	{
+		CandidateAll();
+		return;
+	}
+	candidateGestureIDs.Reset();
+	for (int32 Rank = 0; Rank < FMath::Max(Prefilter.MaxCandidates, 1); Rank++)
+	{
+		int32 BestIndex = INDEX_NONE;
+		for (int32 i = 0; i < prefilterCosts.Num(); i++)
+		{
+			if (prefilterCosts[i] != INFINITY && prefilterCosts[i] <= BestCost + Prefilter.CostMargin && (BestIndex == INDEX_NONE || prefilterCosts[i] < prefilterCosts[BestIndex]))
+				BestIndex = i;
+		}
+		if (BestIndex == INDEX_NONE)
+			break;
+
+		candidateGestureIDs.Add(listenedGestureIDs[BestIndex]);
+		prefilterCosts[BestIndex] = INFINITY;
+	}
+
+	// re-spread the particles of discarded gestures at the beginning of the candidates
+	for (int ParticleIndex = 0; ParticleIndex < EngineParameters.numberParticles; ParticleIndex++)
+	{
+		if (!GestureParticles.IsValidIndex(ParticleIndex))
+			continue;
+		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+
+		if (!candidateGestureIDs.Contains(Particle->GestureID))
+		{
+			Particle->GestureID = pickGestureID(ParticleIndex);
+			Particle->Progression = (RN.GetRandomUniform() - 0.5) * EngineParameters.alignmentSpreadingRange + EngineParameters.alignmentSpreadingCenter;
+			proposeParticle(Particle, RN);
 		}
-
-		Particle->Prior = 1.0 / (float)EngineParameters.numberParticles;
-
-		// set the posterior to the prior at the initialization
-		Particle->Posterior = Particle->Prior;
-
-		// auto select a gesture id based on the one available 
-		Particle->GestureID = GestureManager->GetGestureIDFromParticleIndex(ParticleIndex);
 	}
-
 }
+
 //--------------------------------------------------------------
 void UVRGestureRecognizer::initNoiseParameters() {
 
@@ -346,22 +1228,43 @@ void UVRGestureRecognizer::initNoiseParameters() {
 		{
 			for (int d = 0; d < RecognizerConfig.Dimensions; d++)
 			{
-				obsMeanRange += (Elem.Value->getMaxRange()[d] - Elem.Value->getMinRange()[d])
+				obsMeanRange += Elem.Value->getRangeWidth(d)
 					/ RecognizerConfig.Dimensions;
 			}
 		}
-		for (auto& Elem : GestureManager->GestureTemplates){
-			for (int d = 0; d<RecognizerConfig.Dimensions; d++)
-				obsMeanRange += (Elem.Value->getMaxRange()[d] - Elem.Value->getMinRange()[d])
-				/ RecognizerConfig.Dimensions;
-		}
 		obsMeanRange /= GestureManager->GestureTemplates.Num();
-		EngineParameters.tolerance = obsMeanRange / 4.0f;  // dividing by an heuristic factor [to be learned?]
+		// heuristic factor, the range used to be summed twice and divided by 4: same tolerance.
+		// FVRGestureAutoTuner searches better values on recorded data
+		EngineParameters.tolerance = obsMeanRange / 2.0f;
+	}
+}
+
+//--------------------------------------------------------------
+// Particle loop of TickListening for one combination of options, on particles [First; Last[
+// @return sum of the posteriors, to normalise the distribution afterwards
+template <bool bTranslate, bool bSegmentation, bool bRotation, bool bGaussian>
+float UVRGestureRecognizer::tickParticles(const FVector& obs, float StepScale, float NoiseScale, int32 First, int32 Last, RandomNumbers& Random)
+{
+	float sumw = 0.0f;
+	for (int ParticleIndex = First; ParticleIndex < Last; ParticleIndex++)
+	{
+		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+
+		for (int m = 0; m < EngineParameters.predictionSteps; m++)
+		{
+			updatePrior<bRotation>(Particle, StepScale, NoiseScale, Random);
+			updateLikelihood<bTranslate, bSegmentation, bRotation, bGaussian>(obs, Particle, ParticleIndex, Random);
+			updatePosterior(Particle);
+		}
+
+		sumw += Particle->Posterior;
 	}
+	return sumw;
 }
 
 //--------------------------------------------------------------
-void UVRGestureRecognizer::updatePrior(FGestureParticle* Particle) {
+template <bool bRotation>
+FORCEINLINE void UVRGestureRecognizer::updatePrior(FGestureParticle* Particle, float StepScale, float NoiseScale, RandomNumbers& Random) {
 
 	if (Particle == NULL)
 	{
@@ -370,27 +1273,31 @@ void UVRGestureRecognizer::updatePrior(FGestureParticle* Particle) {
 	}
 
 	// Update alignment / dynamics / scalings
-	float L = GestureManager->GetTemplateLength(Particle->GestureID);
+	// at a fixed rate, templates recorded at another rate are stretched to it
+	float L = RecognizerConfig.FixedRate > 0.0f
+		? GestureManager->GetTemplateLengthAtRate(Particle->GestureID, RecognizerConfig.FixedRate)
+		: GestureManager->GetTemplateLength(Particle->GestureID);
 	if (L == 0)
 	{
 		UE_LOG(VRGesturePluginLog, Error, TEXT("[%s::updatePrior] Template path is equal to zero. GestureID:%d"), *GetName(), Particle->GestureID);
 		return;
 	}
 
-	Particle->Progression += RN.GetRandomNormal() * EngineParameters.alignmentVariance + Particle->Dynamic.X / L; // +Particle->Dynamic.Y / (L*L);
+	// StepScale is the number of input samples covered by this update
+	Particle->Progression += Random.GetRandomNormal() * EngineParameters.alignmentVariance * NoiseScale + Particle->Dynamic.X * StepScale / L; // +Particle->Dynamic.Y / (L*L);
 
-	Particle->Dynamic.X += RN.GetRandomNormal() * EngineParameters.dynamicsVariance.X + Particle->Dynamic.Y / L;
-	Particle->Dynamic.Y += RN.GetRandomNormal() * EngineParameters.dynamicsVariance.X;
+	Particle->Dynamic.X += Random.GetRandomNormal() * EngineParameters.dynamicsVariance.X * NoiseScale + Particle->Dynamic.Y * StepScale / L;
+	Particle->Dynamic.Y += Random.GetRandomNormal() * EngineParameters.dynamicsVariance.X * NoiseScale;
 
-	Particle->Scale.X += RN.GetRandomNormal() * EngineParameters.scalingsVariance.X;
-	Particle->Scale.Y += RN.GetRandomNormal() * EngineParameters.scalingsVariance.Y;
-	Particle->Scale.Z += RN.GetRandomNormal() * EngineParameters.scalingsVariance.Z;
+	Particle->Scale.X += Random.GetRandomNormal() * EngineParameters.scalingsVariance.X * NoiseScale;
+	Particle->Scale.Y += Random.GetRandomNormal() * EngineParameters.scalingsVariance.Y * NoiseScale;
+	Particle->Scale.Z += Random.GetRandomNormal() * EngineParameters.scalingsVariance.Z * NoiseScale;
 
-	if (rotationsDim != 0)
+	if (bRotation)
 	{
-		Particle->Rotation.X += RN.GetRandomNormal() * EngineParameters.rotationsVariance.X;
-		Particle->Rotation.Y += RN.GetRandomNormal() * EngineParameters.rotationsVariance.Y;
-		Particle->Rotation.Z += RN.GetRandomNormal() * EngineParameters.rotationsVariance.Z;
+		Particle->Rotation.X += Random.GetRandomNormal() * EngineParameters.rotationsVariance.X * NoiseScale;
+		Particle->Rotation.Y += Random.GetRandomNormal() * EngineParameters.rotationsVariance.Y * NoiseScale;
+		Particle->Rotation.Z += Random.GetRandomNormal() * EngineParameters.rotationsVariance.Z * NoiseScale;
 	}
 
 	// update prior (Bayesian incremental inference)
@@ -398,7 +1305,8 @@ void UVRGestureRecognizer::updatePrior(FGestureParticle* Particle) {
 }
 
 //--------------------------------------------------------------
-void UVRGestureRecognizer::updateLikelihood(FVector obs, FGestureParticle* Particle, int32 ParticleIndex)
+template <bool bTranslate, bool bSegmentation, bool bRotation, bool bGaussian>
+FORCEINLINE void UVRGestureRecognizer::updateLikelihood(const FVector& obs, FGestureParticle* Particle, int32 ParticleIndex, RandomNumbers& Random)
 {
 	if (Particle == NULL)
 	{
@@ -408,7 +1316,7 @@ void UVRGestureRecognizer::updateLikelihood(FVector obs, FGestureParticle* Parti
 
 	FVector vobs = obs;
 
-	if (RecognizerConfig.bTranslate)
+	if (bTranslate)
 	{
 		vobs = vobs - Particle->Offset;
 	}
@@ -416,15 +1324,19 @@ void UVRGestureRecognizer::updateLikelihood(FVector obs, FGestureParticle* Parti
 	if (Particle->Progression < 0.0)
 	{
 		Particle->Progression = fabs(Particle->Progression);  // re-spread at the beginning
-		if (RecognizerConfig.bSegmentation)
-			Particle->GestureID = GestureManager->GetGestureIDFromParticleIndex(ParticleIndex);  // Select new gesture id (In case new ones or deleted ones)
+		if (bSegmentation)
+		{
+			Particle->GestureID = pickGestureID(ParticleIndex);  // Select new gesture id (In case new ones or deleted ones)
+			proposeParticle(Particle, Random);
+		}
 	}
 	else if (Particle->Progression > 1.0)
 	{
-		if (RecognizerConfig.bSegmentation)
+		if (bSegmentation)
 		{
 			Particle->Progression = fabs(1.0 - Particle->Progression); // re-spread at the beginning
-			Particle->GestureID = GestureManager->GetGestureIDFromParticleIndex(ParticleIndex); // Select new gesture id (In case new ones or deleted ones)
+			Particle->GestureID = pickGestureID(ParticleIndex); // Select new gesture id (In case new ones or deleted ones)
+			proposeParticle(Particle, Random);
 		}
 		else {
 			Particle->Progression = fabs(2.0 - Particle->Progression); // re-spread at the end
@@ -439,138 +1351,230 @@ void UVRGestureRecognizer::updateLikelihood(FVector obs, FGestureParticle* Parti
 		return;
 	}
 
-	float cursor = Particle->Progression;
-	int frameindex = std::min((GestureTemplate->getTemplateLength() - 1), (int)(floor(cursor * GestureTemplate->getTemplateLength())));
-
-	FVector vref = GestureTemplate->templateRaw[frameindex];
+	float dist;
+	if (featureKernel != nullptr)
+	{
+		dist = featureDistance(GestureTemplate, Particle);
+	}
+	else
+	{
+		float cursor = Particle->Progression;
+		FVector vref = GestureTemplate->getSampleAt(cursor);
 
-	// Apply scaling coefficients
-	vref *= Particle->Scale;
+		// Apply scaling coefficients
+		vref *= Particle->Scale;
 
-	// Apply rotation coefficients
+		// Rotate template sample according to the estimated angles of rotations (3d)
+		if (bRotation)
+			vref = rotate3d(vref, Particle->Rotation.X, Particle->Rotation.Y, Particle->Rotation.Z);
 
-	// Rotate template sample according to the estimated angles of rotations (3d)
-	vector<vector< float> > RotMatrix = getRotationMatrix3d(Particle->Rotation.X, Particle->Rotation.Y, Particle->Rotation.Z);
-	vector<float> vrefVec;
-	vrefVec.push_back(vref.X);
-	vrefVec.push_back(vref.Y);
-	vrefVec.push_back(vref.Z);
+		// weighted euclidean distance, 2-D gestures ignore Z
+		if (RecognizerConfig.Dimensions == 2)
+			dist = WeightedSquaredDistance<2>(&vref.X, &vobs.X, &EngineParameters.dimWeights.X);
+		else
+			dist = WeightedSquaredDistance<3>(&vref.X, &vobs.X, &EngineParameters.dimWeights.X);
+	}
 
-	vrefVec = multiplyMat(RotMatrix, vrefVec);
+	// the log domain only needs the log-likelihood
+	if (EngineParameters.bLogWeights) {
+		if (bGaussian)    // Gaussian distribution
+			Particle->LogLikelihood = -dist / (EngineParameters.tolerance * EngineParameters.tolerance);
+		else if (EngineParameters.bFastLikelihood)    // Student's distribution, log(x) == log2(x) * ln(2)
+			Particle->LogLikelihood = likelihoodExponent * fastLog2(dist * likelihoodScale + 1) * 0.693147181f;
+		else
+			Particle->LogLikelihood = (-EngineParameters.distribution / 2 - 1) * log(dist / EngineParameters.distribution + 1);
+	}
+	else if (EngineParameters.bFastLikelihood) {
+		if (bGaussian)    // Gaussian distribution
+			Particle->Likelihood = fastExp2(-dist * likelihoodScale);
+		else            // Student's distribution
+			Particle->Likelihood = fastExp2(likelihoodExponent * fastLog2(dist * likelihoodScale + 1));
+	}
+	else if (bGaussian) {    // Gaussian distribution
+		Particle->Likelihood = exp(-dist * 1 / (EngineParameters.tolerance * EngineParameters.tolerance));
+	}
+	else {            // Student's distribution
+		Particle->Likelihood = pow(dist / EngineParameters.distribution + 1, -EngineParameters.distribution / 2 - 1);    // dimension is 2 .. pay attention if editing]
+	}
+}
 
-	vector<float> vobsVec;
-	vobsVec.push_back(vobs.X);
-	vobsVec.push_back(vobs.Y);
-	vobsVec.push_back(vobs.Z);
+//--------------------------------------------------------------
+// Distance of the last input feature to a feature template. Scalings are uniform (Scale.X)
+// and there is no rotation in feature space
+float UVRGestureRecognizer::featureDistance(UVRGestureTemplate* GestureTemplate, FGestureParticle* Particle)
+{
+	const int32 NumDimensions = GestureTemplate->featureDimensions;
+	const float* Reference = GestureTemplate->getFeatureAt(Particle->Progression);
 
-	vector<float> dimWeights;
-	dimWeights.push_back(EngineParameters.dimWeights.X);
-	dimWeights.push_back(EngineParameters.dimWeights.Y);
-	dimWeights.push_back(EngineParameters.dimWeights.Z);
+	float ScaledReference[VRGESTURE_MAX_FEATURE_DIMENSIONS];
+	for (int32 k = 0; k < NumDimensions; k++)
+		ScaledReference[k] = Reference[k] * Particle->Scale.X;
 
-	// weighted euclidean distance
-	float dist = distance_weightedEuclidean(vrefVec, vobsVec, dimWeights);
+	return featureKernel(ScaledReference, CurrentGesture->getLastFeature(), featureWeights.GetData());
+}
 
-	if (EngineParameters.distribution == 0.0f) {    // Gaussian distribution
-		Particle->Likelihood = exp(-dist * 1 / (EngineParameters.tolerance * EngineParameters.tolerance));
+//--------------------------------------------------------------
+// Cache the constants of the fast likelihood, must be called whenever
+// tolerance or distribution change
+void UVRGestureRecognizer::updateLikelihoodConstants()
+{
+	if (EngineParameters.distribution == 0.0f) {
+		// exp(-d / tol^2) == 2^(-d * log2(e) / tol^2)
+		likelihoodScale = 1.44269504f / (EngineParameters.tolerance * EngineParameters.tolerance);
+		likelihoodExponent = 0.0f;
 	}
-	else {            // Student's distribution
-		Particle->Likelihood = pow(dist / EngineParameters.distribution + 1, -EngineParameters.distribution / 2 - 1);    // dimension is 2 .. pay attention if editing]
+	else {
+		// (d / nu + 1)^(-nu / 2 - 1) == 2^((-nu / 2 - 1) * log2(d / nu + 1))
+		likelihoodScale = 1.0f / EngineParameters.distribution;
+		likelihoodExponent = -EngineParameters.distribution / 2 - 1;
 	}
 }
 
 //--------------------------------------------------------------
-void UVRGestureRecognizer::updatePosterior(FGestureParticle* Particle) {
+FORCEINLINE void UVRGestureRecognizer::updatePosterior(FGestureParticle* Particle) {
 
 	if (Particle == NULL)
 	{
 		// TODO ERROR
 		return;
 	}
-	Particle->Posterior = Particle->Prior * Particle->Likelihood;
+	if (EngineParameters.bLogWeights)
+		Particle->LogPosterior += Particle->LogLikelihood;
+	else
+		Particle->Posterior = Particle->Prior * Particle->Likelihood;
 }
 
 //--------------------------------------------------------------
-void UVRGestureRecognizer::resampleAccordingToWeights(FVector obs)
+// Normalise the log weights with log-sum-exp and update the linear posteriors
+// @return the sum of the squared normalised weights (1 / effective sample size)
+float UVRGestureRecognizer::normaliseLogWeights()
 {
+	int NumberOfParticles = FMath::Min(EngineParameters.numberParticles, GestureParticles.Num());
 
-	// cumulative dist
-	int NumberOfParticles = EngineParameters.numberParticles;
+	float maxLogw = -INFINITY;
+	for (int ParticleIndex = 0; ParticleIndex < NumberOfParticles; ParticleIndex++)
+	{
+		maxLogw = FMath::Max(maxLogw, GestureParticles[ParticleIndex].LogPosterior);
+	}
 
-	TArray<float>    Dist;
-	TArray<int>	OldGestureID;
-	TArray<float> OldProgression;
-	TArray<FVector>	OldDynamic;
-	TArray<FVector>	OldScale;
-	TArray<FVector>	OldRotation;
-
-	// Allocate space 
-	Dist.SetNumUninitialized(EngineParameters.numberParticles);
-	OldGestureID.SetNumUninitialized(NumberOfParticles);
-	OldProgression.SetNumUninitialized(NumberOfParticles);
-	OldDynamic.SetNumUninitialized(NumberOfParticles);
-	OldScale.SetNumUninitialized(NumberOfParticles);
-	OldRotation.SetNumUninitialized(NumberOfParticles);
-
-	// Save old data
+	// shifting by the max keeps the best particle at weight 1, so the sum can not underflow to 0
+	float sumw = 0.0f;
 	for (int ParticleIndex = 0; ParticleIndex < NumberOfParticles; ParticleIndex++)
 	{
-		if (!GestureParticles.IsValidIndex(ParticleIndex))
-		{
-			// TODO ERROR
-			continue;
-		}
 		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
-
-		OldGestureID[ParticleIndex] = Particle->GestureID;
-		OldProgression[ParticleIndex] = Particle->Progression;
-		OldDynamic[ParticleIndex] = Particle->Dynamic;
-		OldScale[ParticleIndex] = Particle->Scale;
-		OldRotation[ParticleIndex] = Particle->Rotation;
+		Particle->Posterior = FMath::Exp(Particle->LogPosterior - maxLogw);
+		sumw += Particle->Posterior;
 	}
 
+	float logSumw = maxLogw + FMath::Loge(sumw);
+	float dotProdw = 0.0f;
+	for (int ParticleIndex = 0; ParticleIndex < NumberOfParticles; ParticleIndex++)
+	{
+		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+		Particle->Posterior /= sumw;
+		Particle->LogPosterior -= logSumw;
+		dotProdw += Particle->Posterior * Particle->Posterior;
+	}
+	return dotProdw;
+}
 
-	// Calculate distance 
-	Dist[0] = 0;
-	for (int ParticleIndex = 1; ParticleIndex < NumberOfParticles; ParticleIndex++)
+//--------------------------------------------------------------
+void UVRGestureRecognizer::resampleAccordingToWeights(FVector obs)
+{
+	int NumberOfParticles = FMath::Min(EngineParameters.numberParticles, GestureParticles.Num());
+
+	// old particles and cumulative weights go to the workspace reserved at train()
+	resampleScratch.SetNumUninitialized(NumberOfParticles, false);
+	resampleCumulative.SetNumUninitialized(NumberOfParticles, false);
+	FMemory::Memcpy(resampleScratch.GetData(), GestureParticles.GetData(), NumberOfParticles * sizeof(FGestureParticle));
+
+	// systematic resampling in blocks of particles: a block prefix sum gives the cumulative
+	// distribution, then each block of new particles binary searches its first source and
+	// walks from there. Same selection as a serial walk, the blocks run on worker threads
+	// for large counts
+	int32 NumBlocks = FMath::DivideAndRoundUp(NumberOfParticles, ParticleBlockSize);
+	bool bSingleThread = NumberOfParticles < ParallelMinParticles;
+	resampleBlockSums.SetNumUninitialized(NumBlocks, false);
+
+	// weights summed per block, the first particle is only reached by u0 <= 0
+	ParallelFor(NumBlocks, [&](int32 Block)
 	{
-		if (!GestureParticles.IsValidIndex(ParticleIndex))
+		int32 First = Block * ParticleBlockSize;
+		int32 Last = FMath::Min(First + ParticleBlockSize, NumberOfParticles);
+		float Sum = 0.0f;
+		for (int32 ParticleIndex = FMath::Max(First, 1); ParticleIndex < Last; ParticleIndex++)
 		{
-			// TODO ERROR
-			continue;
+			Sum += GestureParticles[ParticleIndex].Posterior;
 		}
-		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+		resampleBlockSums[Block] = Sum;
+	}, bSingleThread);
 
-		Dist[ParticleIndex] = Dist[ParticleIndex - 1] + Particle->Posterior;
+	// exclusive scan of the blocks, in block order
+	float Offset = 0.0f;
+	for (int32 Block = 0; Block < NumBlocks; Block++)
+	{
+		float Sum = resampleBlockSums[Block];
+		resampleBlockSums[Block] = Offset;
+		Offset += Sum;
 	}
-	float u0 = (RN.GetRandomUniform() - 0.5) / NumberOfParticles;
 
-	int i = 0;
-	for (int ParticleIndex = 0; ParticleIndex < NumberOfParticles; ParticleIndex++)
+	// cumulative dist
+	ParallelFor(NumBlocks, [&](int32 Block)
 	{
-		if (!GestureParticles.IsValidIndex(ParticleIndex))
+		int32 First = Block * ParticleBlockSize;
+		int32 Last = FMath::Min(First + ParticleBlockSize, NumberOfParticles);
+		float Cumulative = resampleBlockSums[Block];
+		for (int32 ParticleIndex = First; ParticleIndex < Last; ParticleIndex++)
 		{
-			// TODO ERROR
-			continue;
+			if (ParticleIndex > 0)
+				Cumulative += GestureParticles[ParticleIndex].Posterior;
+			resampleCumulative[ParticleIndex] = Cumulative;
 		}
-		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+	}, bSingleThread);
 
-		float uj = u0 + (ParticleIndex + 0.) / NumberOfParticles;
+	float u0 = (RN.GetRandomUniform() - 0.5) / NumberOfParticles;
+	float Posterior = 1.0 / (float)NumberOfParticles;
+	float LogPosterior = -FMath::Loge((float)NumberOfParticles);
 
-		while (uj > Dist[i] && i < NumberOfParticles - 1) {
-			i++;
+	ParallelFor(NumBlocks, [&](int32 Block)
+	{
+		int32 First = Block * ParticleBlockSize;
+		int32 Last = FMath::Min(First + ParticleBlockSize, NumberOfParticles);
+
+		// first source with a cumulative weight reaching the block's first pointer
+		float u = u0 + (First + 0.) / NumberOfParticles;
+		int32 Low = 0;
+		int32 High = NumberOfParticles - 1;
+		while (Low < High)
+		{
+			int32 Mid = (Low + High) / 2;
+			if (u > resampleCumulative[Mid]) Low = Mid + 1;
+			else High = Mid;
 		}
+		int32 i = Low;
+
+		for (int32 ParticleIndex = First; ParticleIndex < Last; ParticleIndex++)
+		{
+			FGestureParticle* Particle = &GestureParticles[ParticleIndex];
 
-		Particle->GestureID = OldGestureID[i];
-		Particle->Progression = OldProgression[i];
-		Particle->Dynamic = OldDynamic[i];
-		Particle->Scale = OldScale[i];
-		Particle->Rotation = OldRotation[i];
+			float uj = u0 + (ParticleIndex + 0.) / NumberOfParticles;
 
-		// update posterior (particles' weights)
-		Particle->Posterior = 1.0 / (float)NumberOfParticles;
-	}
+			while (uj > resampleCumulative[i] && i < NumberOfParticles - 1) {
+				i++;
+			}
+
+			const FGestureParticle& Source = resampleScratch[i];
+			Particle->GestureID = Source.GestureID;
+			Particle->Progression = Source.Progression;
+			Particle->Dynamic = Source.Dynamic;
+			Particle->Scale = Source.Scale;
+			Particle->Rotation = Source.Rotation;
 
+			// update posterior (particles' weights)
+			Particle->Posterior = Posterior;
+			Particle->LogPosterior = LogPosterior;
+		}
+	}, bSingleThread);
 }
 
 //--------------------------------------------------------------
@@ -579,7 +1583,11 @@ void UVRGestureRecognizer::estimates() {
 
 	int NumberOfParticles = EngineParameters.numberParticles;
 
-	GestureManager->InitEstimates();
+	for (auto& Elem : GestureEstimates)
+	{
+		Elem.Value.Reset();
+	}
+
 	for (int ParticleIndex = 0; ParticleIndex < NumberOfParticles; ParticleIndex++)
 	{
 		if (!GestureParticles.IsValidIndex(ParticleIndex))
@@ -589,7 +1597,9 @@ void UVRGestureRecognizer::estimates() {
 		}
 		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
 
-		(*GestureManager->GestureTemplates.Find(Particle->GestureID))->probabilityNormalisation += Particle->Posterior;
+		FVRGestureEstimate* Estimate = GestureEstimates.Find(Particle->GestureID);
+		if (Estimate)
+			Estimate->probabilityNormalisation += Particle->Posterior;
 	}
 
 
@@ -603,46 +1613,53 @@ void UVRGestureRecognizer::estimates() {
 		}
 		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
 
-		UVRGestureTemplate* Gesture = *GestureManager->GestureTemplates.Find(Particle->GestureID);
+		FVRGestureEstimate* Estimate = GestureEstimates.Find(Particle->GestureID);
 
-		if (Gesture == NULL)
+		if (Estimate == NULL)
 		{
 			UE_LOG(VRGesturePluginLog, Log, TEXT("[%s::estimates2] Failed to retrieve gesture with ID: %d"), *GetName(), Particle->GestureID);
 			continue;
 		}
 
-		Gesture->estimatedAlignment += Particle->Progression * Particle->Posterior;
+		Estimate->alignment += Particle->Progression * Particle->Posterior;
 
-		Gesture->estimatedDynamics += Particle->Dynamic * (Particle->Posterior / Gesture->probabilityNormalisation);
+		Estimate->dynamics += Particle->Dynamic * (Particle->Posterior / Estimate->probabilityNormalisation);
 
-		Gesture->estimatedScalings += Particle->Scale * (Particle->Posterior / Gesture->probabilityNormalisation);
+		Estimate->scalings += Particle->Scale * (Particle->Posterior / Estimate->probabilityNormalisation);
 		
 		if (rotationsDim != 0)
-			Gesture->estimatedRotations += Particle->Rotation * (Particle->Posterior / Gesture->probabilityNormalisation);
+			Estimate->rotations += Particle->Rotation * (Particle->Posterior / Estimate->probabilityNormalisation);
 
 		if (!isnan(Particle->Posterior))
-			Gesture->estimatedProbabilities += Particle->Posterior;
+			Estimate->probability += Particle->Posterior;
 
-		Gesture->estimatedLikelihoods += Particle->Likelihood;
+		// no linear likelihood in the log domain, outcomes only read the probability
+		if (!EngineParameters.bLogWeights)
+			Estimate->likelihood += Particle->Likelihood;
 	}
 
+	bOutcomesDirty = true;
+
 	// calculate most probable index during scaling...
 	float maxProbability = 0.0f;
 	mostProbableIndex = -1;
 
-	for (auto& Elem : GestureManager->GestureTemplates) {
-		if (Elem.Value->estimatedProbabilities > maxProbability) {
-			maxProbability = Elem.Value->estimatedProbabilities;
-			mostProbableIndex = Elem.Value->GestureID;
+	for (auto& Elem : GestureEstimates) {
+		if (Elem.Value.probability > maxProbability) {
+			maxProbability = Elem.Value.probability;
+			mostProbableIndex = Elem.Key;
 
 		}
 	}
 
-	UVRGestureTemplate* MostProbableGesture = *GestureManager->GestureTemplates.Find(mostProbableIndex);
+	if (progressTriggers.Num() > 0)
+		updateProgressTriggers();
+
+	FVRGestureEstimate* MostProbableEstimate = GestureEstimates.Find(mostProbableIndex);
 
-	if (MostProbableGesture != NULL)
+	if (MostProbableEstimate != NULL)
 	{
-		if (MostProbableGesture->estimatedAlignment > 0.95 && MostProbableGesture->estimatedProbabilities > 0.9)
+		if (MostProbableEstimate->alignment > 0.95 && MostProbableEstimate->probability > 0.9)
 		{
 			OnGestureActivated.Broadcast(mostProbableIndex);
 			// Reset current gesture
@@ -654,45 +1671,233 @@ void UVRGestureRecognizer::estimates() {
 }
 
 //--------------------------------------------------------------
-// Update the number of particles
-void UVRGestureRecognizer::setNumberOfParticles(int numberOfParticles) {
+// Threshold crossings of the progress triggers, only the crossings reach Blueprint
+void UVRGestureRecognizer::updateProgressTriggers()
+{
+	// crossings are broadcast once every trigger is updated: handlers may add or remove triggers
+	progressCrossings.Reset();
+	for (FProgressTriggerState& State : progressTriggers)
+	{
+		const FVRGestureEstimate* Estimate = GestureEstimates.Find(State.Trigger.GestureID);
+		if (Estimate == nullptr)
+			continue;
 
-	EngineParameters.numberParticles = numberOfParticles;
+		const TArray<float>& Thresholds = State.Trigger.Thresholds;
 
-	if (EngineParameters.numberParticles < 4)     // minimum number of particles allowed
-		EngineParameters.numberParticles = 4;
+		// arm again the thresholds the progression fell below
+		while (State.NumReached > 0 && Estimate->alignment < Thresholds[State.NumReached - 1] - State.Trigger.Hysteresis)
+		{
+			State.NumReached--;
+		}
 
-	train();
+		if (Estimate->probability < State.Trigger.MinProbability)
+			continue;
 
-	if (EngineParameters.numberParticles <= EngineParameters.resamplingThreshold) {
-		EngineParameters.resamplingThreshold = EngineParameters.numberParticles / 4;
+		while (State.NumReached < Thresholds.Num() && Estimate->alignment >= Thresholds[State.NumReached])
+		{
+			FProgressCrossing& Crossing = progressCrossings[progressCrossings.AddUninitialized()];
+			Crossing.GestureID = State.Trigger.GestureID;
+			Crossing.Handle = State.Handle;
+			Crossing.ThresholdIndex = State.NumReached;
+			Crossing.Threshold = Thresholds[State.NumReached];
+			State.NumReached++;
+		}
 	}
 
+	for (const FProgressCrossing& Crossing : progressCrossings)
+	{
+		OnGestureProgress.Broadcast(Crossing.GestureID, Crossing.Handle, Crossing.ThresholdIndex, Crossing.Threshold);
+	}
 }
 
 //--------------------------------------------------------------
-int UVRGestureRecognizer::getNumberOfParticles() {
-	return EngineParameters.numberParticles; // Return the number of particles
+int32 UVRGestureRecognizer::addProgressTrigger(const FVRGestureProgressTrigger& trigger)
+{
+	FProgressTriggerState& State = progressTriggers[progressTriggers.AddDefaulted()];
+	State.Trigger = trigger;
+	State.Trigger.Thresholds.Sort();
+	State.Handle = nextProgressTriggerHandle++;
+	State.NumReached = 0;
+
+	// every threshold can be crossed in one update
+	int32 NumThresholds = 0;
+	for (const FProgressTriggerState& Other : progressTriggers)
+	{
+		NumThresholds += Other.Trigger.Thresholds.Num();
+	}
+	progressCrossings.Reserve(NumThresholds);
+	return State.Handle;
 }
 
 //--------------------------------------------------------------
-void UVRGestureRecognizer::setPredictionSteps(int predictionSteps)
+bool UVRGestureRecognizer::removeProgressTrigger(int32 handle)
 {
-	if (predictionSteps<1)
-		EngineParameters.predictionSteps = 1;
-	else
-		EngineParameters.predictionSteps = predictionSteps;
+	return progressTriggers.RemoveAll([handle](const FProgressTriggerState& State) { return State.Handle == handle; }) > 0;
 }
 
 //--------------------------------------------------------------
-int UVRGestureRecognizer::getPredictionSteps()
+void UVRGestureRecognizer::clearProgressTriggers()
 {
-	return EngineParameters.predictionSteps; // Return the number of particles
+	progressTriggers.Reset();
 }
 
 //--------------------------------------------------------------
-// Update the re sampling threshold used to avoid degeneracy problem
-void UVRGestureRecognizer::setResamplingThreshold(int _resamplingThreshold) {
+// Update the number of particles
+void UVRGestureRecognizer::setNumberOfParticles(int numberOfParticles) {
+
+	requestedNumberParticles = FMath::Max(numberOfParticles, 4);
+	EngineParameters.numberParticles = getBudgetedNumberOfParticles();
+
+	train();
+
+	if (EngineParameters.numberParticles <= EngineParameters.resamplingThreshold) {
+		EngineParameters.resamplingThreshold = EngineParameters.numberParticles / 4;
+	}
+
+}
+
+//--------------------------------------------------------------
+// Change the number of particles by resampling the current posterior, the
+// filter keeps running and the estimates are preserved
+void UVRGestureRecognizer::resizeParticles(int numberOfParticles) {
+
+	requestedNumberParticles = FMath::Max(numberOfParticles, 4);
+	resampleParticles(getBudgetedNumberOfParticles());
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::resampleParticles(int numberOfParticles) {
+
+	if (numberOfParticles < 4)     // minimum number of particles allowed
+		numberOfParticles = 4;
+
+	int OldNumberOfParticles = FMath::Min(EngineParameters.numberParticles, GestureParticles.Num());
+	if (numberOfParticles == EngineParameters.numberParticles)
+		return;
+
+	// keep the same proportion of active particles before resampling
+	float thresholdRatio = (float)EngineParameters.resamplingThreshold / (float)FMath::Max(EngineParameters.numberParticles, 1);
+	EngineParameters.numberParticles = numberOfParticles;
+	EngineParameters.resamplingThreshold = FMath::Max(1, (int)(thresholdRatio * numberOfParticles));
+
+	if (state != EVRGestureRecognizerState::Listening || OldNumberOfParticles == 0)
+	{
+		// not running, particles are initialised at the next train()
+		return;
+	}
+
+	resampleScratch.SetNumUninitialized(OldNumberOfParticles, false);
+	FMemory::Memcpy(resampleScratch.GetData(), GestureParticles.GetData(), OldNumberOfParticles * sizeof(FGestureParticle));
+	TArray<FGestureParticle>& OldParticles = resampleScratch;
+	GestureParticles.SetNumUninitialized(numberOfParticles, false);
+
+	// systematic resampling from the old posterior to the new count
+	float u0 = RN.GetRandomUniform() / numberOfParticles;
+	float cumulative = OldParticles[0].Posterior;
+	int i = 0;
+	for (int ParticleIndex = 0; ParticleIndex < numberOfParticles; ParticleIndex++)
+	{
+		float uj = u0 + (ParticleIndex + 0.) / numberOfParticles;
+
+		while (uj > cumulative && i < OldNumberOfParticles - 1) {
+			i++;
+			cumulative += OldParticles[i].Posterior;
+		}
+
+		FGestureParticle* Particle = &GestureParticles[ParticleIndex];
+		*Particle = OldParticles[i];
+		Particle->Posterior = 1.0 / (float)numberOfParticles;
+		Particle->Prior = Particle->Posterior;
+		Particle->LogPosterior = -FMath::Loge((float)numberOfParticles);
+	}
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setUpdateInterval(int _updateInterval) {
+	updateInterval = FMath::Max(1, _updateInterval);
+}
+
+//--------------------------------------------------------------
+int UVRGestureRecognizer::getUpdateInterval() {
+	return updateInterval;
+}
+
+//--------------------------------------------------------------
+// Budget throttling: the first levels double the update interval (up to x8),
+// the next ones halve the number of particles
+int UVRGestureRecognizer::getBudgetedUpdateInterval() {
+	return updateInterval << FMath::Min(budgetThrottle, 3);
+}
+
+//--------------------------------------------------------------
+int UVRGestureRecognizer::getBudgetedNumberOfParticles() {
+	return FMath::Max(requestedNumberParticles >> FMath::Max(budgetThrottle - 3, 0), 4);
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setBudgetThrottle(int throttle) {
+	throttle = bDeterministic ? 0 : FMath::Clamp(throttle, 0, MaxBudgetThrottle);
+	if (throttle == budgetThrottle)
+		return;
+
+	budgetThrottle = throttle;
+	resampleParticles(getBudgetedNumberOfParticles());
+}
+
+//--------------------------------------------------------------
+int UVRGestureRecognizer::getBudgetThrottle() {
+	return budgetThrottle;
+}
+
+//--------------------------------------------------------------
+float UVRGestureRecognizer::consumeFrameCost() {
+	// exponential moving average of the cost per frame, frames without update included
+	float frameCostUs = FPlatformTime::ToMilliseconds(frameCostCycles) * 1000.0f;
+	averageFrameCostUs += (frameCostUs - averageFrameCostUs) * 0.1f;
+	frameCostCycles = 0;
+	return averageFrameCostUs;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setBudgetPriority(float priority) {
+	budgetPriority = priority;
+}
+
+//--------------------------------------------------------------
+float UVRGestureRecognizer::getBudgetPriority() {
+	return budgetPriority;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::applyLOD(const FVRGestureRecognitionLOD& LOD) {
+	resizeParticles(LOD.NumberParticles);
+	setPredictionSteps(LOD.PredictionSteps);
+	setUpdateInterval(LOD.UpdateInterval);
+}
+
+//--------------------------------------------------------------
+int UVRGestureRecognizer::getNumberOfParticles() {
+	return EngineParameters.numberParticles; // Return the number of particles
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setPredictionSteps(int predictionSteps)
+{
+	if (predictionSteps<1)
+		EngineParameters.predictionSteps = 1;
+	else
+		EngineParameters.predictionSteps = predictionSteps;
+}
+
+//--------------------------------------------------------------
+int UVRGestureRecognizer::getPredictionSteps()
+{
+	return EngineParameters.predictionSteps; // Return the number of particles
+}
+
+//--------------------------------------------------------------
+// Update the re sampling threshold used to avoid degeneracy problem
+void UVRGestureRecognizer::setResamplingThreshold(int _resamplingThreshold) {
 	if (_resamplingThreshold >= EngineParameters.numberParticles)
 		_resamplingThreshold = floor(EngineParameters.numberParticles / 2.0f);
 	EngineParameters.resamplingThreshold = _resamplingThreshold;
@@ -713,6 +1918,7 @@ void UVRGestureRecognizer::setTolerance(float _tolerance) {
 	if (_tolerance <= 0.0) _tolerance = 0.1;
 	EngineParameters.tolerance = _tolerance;
 	tolerancesetmanually = true;
+	updateLikelihoodConstants();
 }
 
 //--------------------------------------------------------------
@@ -720,6 +1926,126 @@ float UVRGestureRecognizer::getTolerance() {
 	return EngineParameters.tolerance;
 }
 
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setEngineParameters(const FGREngineParameters& parameters) {
+	// a parameter set read with getEngineParameters keeps the computed tolerance
+	if (parameters.tolerance <= 0.0f)
+		tolerancesetmanually = false;
+	else if (parameters.tolerance != EngineParameters.tolerance)
+		tolerancesetmanually = true;
+
+	EngineParameters = parameters;
+	requestedNumberParticles = FMath::Max(parameters.numberParticles, 4);
+	EngineParameters.numberParticles = getBudgetedNumberOfParticles();
+	EngineParameters.resamplingThreshold = FMath::Clamp(parameters.resamplingThreshold, 1, EngineParameters.numberParticles);
+	updateLikelihoodConstants();
+	train();
+}
+
+//--------------------------------------------------------------
+const FGREngineParameters& UVRGestureRecognizer::getEngineParameters() {
+	return EngineParameters;
+}
+
+//--------------------------------------------------------------
+int32 UVRGestureRecognizer::getMostProbableGesture() {
+	return mostProbableIndex;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setRandomSeed(uint64 seed) {
+	RN.SetSeed(seed);
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setDeterministic(bool deterministicFlag, uint64 seed) {
+	bDeterministic = deterministicFlag;
+	deterministicSeed = seed;
+	deterministicUpdates = 0;
+	RN.SetSeed(seed);
+
+	// the scheduler would change the particle count and update interval with the load
+	if (state == EVRGestureRecognizerState::Listening && bBudgetManaged)
+	{
+		if (bDeterministic)
+			FVRGestureBudgetScheduler::Get().Unregister(this);
+		else
+			FVRGestureBudgetScheduler::Get().Register(this);
+	}
+	if (bDeterministic)
+		setBudgetThrottle(0);
+}
+
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::isDeterministic() {
+	return bDeterministic;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setDimensions(int dimensions) {
+	RecognizerConfig.Dimensions = FMath::Clamp(dimensions, 1, VRGESTURE_MAX_FEATURE_DIMENSIONS);
+	bFeatureInput = true;
+}
+
+//--------------------------------------------------------------
+// Feature dimension of the input, 0 while only positions are expected
+int32 UVRGestureRecognizer::getFeatureInputDimensions() {
+	return (featureKernel != nullptr || bFeatureInput) ? RecognizerConfig.Dimensions : 0;
+}
+
+//--------------------------------------------------------------
+int UVRGestureRecognizer::getDimensions() {
+	return RecognizerConfig.Dimensions;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setFeatureWeights(const TArray<float>& weights) {
+	featureWeights = weights;
+	while (featureWeights.Num() < RecognizerConfig.Dimensions)
+		featureWeights.Add(1.0f);
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setDistribution(float distribution) {
+	if (distribution < 0.0f) distribution = 0.0f;
+	EngineParameters.distribution = distribution;
+	updateLikelihoodConstants();
+}
+
+//--------------------------------------------------------------
+float UVRGestureRecognizer::getDistribution() {
+	return EngineParameters.distribution;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setFastLikelihood(bool fastLikelihood) {
+	EngineParameters.bFastLikelihood = fastLikelihood;
+	updateLikelihoodConstants();
+}
+
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::getFastLikelihood() {
+	return EngineParameters.bFastLikelihood;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setLogWeights(bool logWeights) {
+	if (logWeights && !EngineParameters.bLogWeights)
+	{
+		// carry the current weights over to the log domain
+		for (FGestureParticle& Particle : GestureParticles)
+		{
+			Particle.LogPosterior = FMath::Loge(FMath::Max(Particle.Posterior, FLT_MIN));
+		}
+	}
+	EngineParameters.bLogWeights = logWeights;
+}
+
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::getLogWeights() {
+	return EngineParameters.bLogWeights;
+}
+
 //--------------------------------------------------------------
 void UVRGestureRecognizer::setDynamicsVariance(FVector dynVariance)
 {
@@ -776,6 +2102,44 @@ void UVRGestureRecognizer::setSpreadRotations(float center, float range, int dim
 	EngineParameters.rotationsSpreadingRange = range;
 }
 
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setSimplification(const FVRGestureSimplification& simplification)
+{
+	Simplification = simplification;
+}
+
+//--------------------------------------------------------------
+FVRGestureSimplifyReport UVRGestureRecognizer::getLastSimplifyReport()
+{
+	return lastSimplifyReport;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setPrefilter(const FVRGesturePrefilter& prefilter)
+{
+	Prefilter = prefilter;
+	candidateGestureIDs = listenedGestureIDs;
+}
+
+//--------------------------------------------------------------
+const TArray<int32>& UVRGestureRecognizer::getCandidateGestures()
+{
+	return candidateGestureIDs;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setMotionGate(const FVRGestureMotionGate& gate)
+{
+	MotionGate = gate;
+	resetMotionGate();
+}
+
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::isMotionGateAsleep()
+{
+	return bMotionGateAsleep;
+}
+
 //--------------------------------------------------------------
 void UVRGestureRecognizer::translate(bool translateFlag)
 {
@@ -786,4 +2150,385 @@ void UVRGestureRecognizer::translate(bool translateFlag)
 void UVRGestureRecognizer::segmentation(bool segmentationFlag)
 {
 	RecognizerConfig.bSegmentation = segmentationFlag;
-}
\ No newline at end of file
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::dataDrivenProposals(bool proposalsFlag, float ratio)
+{
+	RecognizerConfig.bDataDrivenProposals = proposalsFlag;
+	RecognizerConfig.ProposalRatio = FMath::Clamp(ratio, 0.0f, 1.0f);
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setFixedRate(float rate)
+{
+	RecognizerConfig.FixedRate = FMath::Max(rate, 0.0f);
+
+	FVRGestureInputPipelineConfig ResamplerConfig;
+	ResamplerConfig.bResample = true;
+	ResamplerConfig.ResampleRate = RecognizerConfig.FixedRate;
+	fixedRateResampler.SetConfig(ResamplerConfig);
+	timeSinceUpdate = 0.0f;
+}
+
+//--------------------------------------------------------------
+float UVRGestureRecognizer::getFixedRate()
+{
+	return RecognizerConfig.FixedRate;
+}
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::setOutcomePublishing(const FVRGestureOutcomePublishing& publishing)
+{
+	OutcomePublishing = publishing;
+	timeSincePublish = 0.0f;
+}
+
+//--------------------------------------------------------------
+const FVRGROutcomes& UVRGestureRecognizer::getOutcomes()
+{
+	return Outcomes;
+}
+
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::publishOutcomes(float DeltaTime)
+{
+	timeSincePublish += DeltaTime;
+
+	if (!OutcomePublishing.bEnabled || state != EVRGestureRecognizerState::Listening || !bOutcomesDirty)
+		return false;
+
+	if (OutcomePublishing.PublishRate > 0.0f && timeSincePublish < 1.0f / OutcomePublishing.PublishRate)
+		return false;
+
+	fillOutcomes();
+	if (OutcomePublishing.MinChange > 0.0f && !outcomesChanged())
+		return false;
+
+	// remember what has been published, element wise to keep the capacity
+	publishedOutcomes.SetNum(Outcomes.Gestures.Num(), false);
+	for (int32 i = 0; i < Outcomes.Gestures.Num(); i++)
+	{
+		publishedOutcomes[i] = Outcomes.Gestures[i];
+	}
+
+	timeSincePublish = 0.0f;
+	bOutcomesDirty = false;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Copy the current estimates into the outcome buffer, most probable first
+void UVRGestureRecognizer::fillOutcomes()
+{
+	TArray<FGestureOutcome>& Gestures = Outcomes.Gestures;
+	Gestures.SetNum(GestureEstimates.Num(), false);
+
+	int32 i = 0;
+	for (auto& Elem : GestureEstimates)
+	{
+		const FVRGestureEstimate& Estimate = Elem.Value;
+		FGestureOutcome& Outcome = Gestures[i++];
+		Outcome.GestureIndex = Elem.Key;
+		Outcome.likelihood = Estimate.probability;
+		Outcome.alignment = Estimate.alignment;
+		Outcome.dynamic = Estimate.dynamics;
+		Outcome.scaling = Estimate.scalings;
+		Outcome.rotation = Estimate.rotations;
+	}
+
+	Gestures.Sort([](const FGestureOutcome& A, const FGestureOutcome& B) { return A.likelihood > B.likelihood; });
+
+	if (OutcomePublishing.TopK > 0 && Gestures.Num() > OutcomePublishing.TopK)
+		Gestures.SetNum(OutcomePublishing.TopK, false);
+
+	Outcomes.likeliestGesture = Gestures.Num() > 0 ? Gestures[0] : FGestureOutcome();
+}
+
+//--------------------------------------------------------------
+// @return true if a gesture entered or left the outcomes, or changed by more than MinChange
+bool UVRGestureRecognizer::outcomesChanged()
+{
+	const TArray<FGestureOutcome>& Gestures = Outcomes.Gestures;
+	if (Gestures.Num() != publishedOutcomes.Num())
+		return true;
+
+	for (const FGestureOutcome& Outcome : Gestures)
+	{
+		const FGestureOutcome* Published = publishedOutcomes.FindByPredicate([&Outcome](const FGestureOutcome& Other) { return Other.GestureIndex == Outcome.GestureIndex; });
+		if (Published == nullptr
+			|| FMath::Abs(Published->likelihood - Outcome.likelihood) > OutcomePublishing.MinChange
+			|| FMath::Abs(Published->alignment - Outcome.alignment) > OutcomePublishing.MinChange)
+			return true;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+// Flat snapshot buffer helpers, values are copied as raw bytes
+template <typename T>
+static void WriteSnapshot(TArray<uint8>& Buffer, const T* Data, int32 Count)
+{
+	int32 Offset = Buffer.AddUninitialized(Count * sizeof(T));
+	FMemory::Memcpy(Buffer.GetData() + Offset, Data, Count * sizeof(T));
+}
+
+template <typename T>
+static void WriteSnapshot(TArray<uint8>& Buffer, const T& Value)
+{
+	WriteSnapshot(Buffer, &Value, 1);
+}
+
+template <typename T>
+static void WriteSnapshotArray(TArray<uint8>& Buffer, const TArray<T>& Array)
+{
+	WriteSnapshot(Buffer, Array.Num());
+	WriteSnapshot(Buffer, Array.GetData(), Array.Num());
+}
+
+struct FSnapshotReader
+{
+	const TArray<uint8>& Buffer;
+	int32 Offset;
+	bool bError;
+
+	FSnapshotReader(const TArray<uint8>& InBuffer) : Buffer(InBuffer), Offset(0), bError(false) {}
+
+	template <typename T>
+	void Read(T* Data, int32 Count)
+	{
+		int32 Size = Count * sizeof(T);
+		if (bError || Count < 0 || Offset + Size > Buffer.Num())
+		{
+			bError = true;
+			return;
+		}
+		FMemory::Memcpy(Data, Buffer.GetData() + Offset, Size);
+		Offset += Size;
+	}
+
+	template <typename T>
+	void Read(T& Value)
+	{
+		Read(&Value, 1);
+	}
+
+	template <typename T>
+	void ReadArray(TArray<T>& Array)
+	{
+		int32 Num = 0;
+		Read(Num);
+		if (bError || Num < 0 || Offset + Num * (int32)sizeof(T) > Buffer.Num())
+		{
+			bError = true;
+			return;
+		}
+		Array.SetNumUninitialized(Num, false);
+		Read(Array.GetData(), Num);
+	}
+};
+
+//--------------------------------------------------------------
+void UVRGestureRecognizer::saveSnapshot(TArray<uint8>& OutSnapshot)
+{
+	// keep the capacity of the previous snapshot
+	OutSnapshot.Reset();
+
+	WriteSnapshot(OutSnapshot, SnapshotMagic);
+	WriteSnapshot(OutSnapshot, SnapshotVersion);
+	WriteSnapshot(OutSnapshot, state);
+
+	// per template estimates
+	WriteSnapshot(OutSnapshot, GestureEstimates.Num());
+	for (auto& Elem : GestureEstimates)
+	{
+		WriteSnapshot(OutSnapshot, Elem.Key);
+		WriteSnapshot(OutSnapshot, Elem.Value);
+	}
+
+	// filter
+	WriteSnapshot(OutSnapshot, RN.GetState());
+	WriteSnapshot(OutSnapshot, deterministicUpdates);
+	WriteSnapshot(OutSnapshot, EngineParameters.numberParticles);
+	WriteSnapshot(OutSnapshot, EngineParameters.resamplingThreshold);
+	WriteSnapshotArray(OutSnapshot, GestureParticles);
+	WriteSnapshotArray(OutSnapshot, candidateGestureIDs);
+	WriteSnapshot(OutSnapshot, mostProbableIndex);
+
+	// reached thresholds, by trigger handle
+	WriteSnapshot(OutSnapshot, progressTriggers.Num());
+	for (const FProgressTriggerState& State : progressTriggers)
+	{
+		WriteSnapshot(OutSnapshot, State.Handle);
+		WriteSnapshot(OutSnapshot, State.NumReached);
+	}
+	WriteSnapshot(OutSnapshot, samplesSinceUpdate);
+	WriteSnapshot(OutSnapshot, timeSinceUpdate);
+
+	// fixed rate resampler, the next sample falls at the same time after a restore
+	bool bResamplerHasPrevious = false;
+	FVector ResamplerPrevious;
+	float ResamplerTimeToNextSample = 0.0f;
+	fixedRateResampler.GetResampleState(bResamplerHasPrevious, ResamplerPrevious, ResamplerTimeToNextSample);
+	WriteSnapshot(OutSnapshot, bResamplerHasPrevious);
+	WriteSnapshot(OutSnapshot, ResamplerPrevious);
+	WriteSnapshot(OutSnapshot, ResamplerTimeToNextSample);
+
+	// motion gate
+	WriteSnapshot(OutSnapshot, lastInputPoint);
+	WriteSnapshot(OutSnapshot, lastInputFeature);
+	WriteSnapshot(OutSnapshot, bHasLastInput);
+	WriteSnapshot(OutSnapshot, bMotionGateAsleep);
+	WriteSnapshot(OutSnapshot, motionGateStillTime);
+
+	// input history
+	bool bHasCurrentGesture = CurrentGesture != nullptr;
+	WriteSnapshot(OutSnapshot, bHasCurrentGesture);
+	if (bHasCurrentGesture)
+	{
+		WriteSnapshot(OutSnapshot, CurrentGesture->inputDimensions);
+		WriteSnapshot(OutSnapshot, CurrentGesture->featureDimensions);
+		WriteSnapshot(OutSnapshot, CurrentGesture->templateInitialObservation);
+		WriteSnapshot(OutSnapshot, CurrentGesture->templateInitialNormal);
+		WriteSnapshot(OutSnapshot, CurrentGesture->observationRangeMax);
+		WriteSnapshot(OutSnapshot, CurrentGesture->observationRangeMin);
+		WriteSnapshotArray(OutSnapshot, CurrentGesture->templateRaw);
+		WriteSnapshotArray(OutSnapshot, CurrentGesture->templateFeatures);
+		WriteSnapshotArray(OutSnapshot, CurrentGesture->templateInitialFeature);
+		WriteSnapshotArray(OutSnapshot, CurrentGesture->featureRangeMax);
+		WriteSnapshotArray(OutSnapshot, CurrentGesture->featureRangeMin);
+	}
+}
+
+//--------------------------------------------------------------
+bool UVRGestureRecognizer::restoreSnapshot(const TArray<uint8>& Snapshot)
+{
+	FSnapshotReader Reader(Snapshot);
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	EVRGestureRecognizerState SnapshotState;
+	Reader.Read(Magic);
+	Reader.Read(Version);
+	Reader.Read(SnapshotState);
+	if (Reader.bError || Magic != SnapshotMagic || Version != SnapshotVersion)
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::restoreSnapshot] Invalid snapshot"), *GetName());
+		return false;
+	}
+
+	// the snapshot only holds the filter state, the recognizer must be in the same state with the same templates
+	if (SnapshotState != state)
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::restoreSnapshot] Snapshot state %s differs from current state %s"), *GetName(), *GetEnumValueToString("EVRGestureRecognizerState", SnapshotState), *GetEnumValueToString("EVRGestureRecognizerState", state));
+		return false;
+	}
+
+	int32 NumTemplates = 0;
+	Reader.Read(NumTemplates);
+	if (NumTemplates != GestureEstimates.Num())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::restoreSnapshot] Templates changed since the snapshot"), *GetName());
+		return false;
+	}
+
+	// every gesture is checked before the first estimate is overwritten
+	FSnapshotReader Validator = Reader;
+	for (int32 i = 0; i < NumTemplates && !Validator.bError; i++)
+	{
+		int32 GestureID = 0;
+		FVRGestureEstimate Estimate;
+		Validator.Read(GestureID);
+		Validator.Read(Estimate);
+		if (!Validator.bError && !GestureEstimates.Contains(GestureID))
+		{
+			UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::restoreSnapshot] Gesture %d does not exist anymore"), *GetName(), GestureID);
+			return false;
+		}
+	}
+
+	for (int32 i = 0; i < NumTemplates && !Reader.bError; i++)
+	{
+		int32 GestureID = 0;
+		Reader.Read(GestureID);
+		if (FVRGestureEstimate* Estimate = GestureEstimates.Find(GestureID))
+			Reader.Read(*Estimate);
+	}
+
+	RandomNumbers::FState RandomState;
+	Reader.Read(RandomState);
+	RN.SetState(RandomState);
+	Reader.Read(deterministicUpdates);
+	Reader.Read(EngineParameters.numberParticles);
+	Reader.Read(EngineParameters.resamplingThreshold);
+	Reader.ReadArray(GestureParticles);
+	Reader.ReadArray(candidateGestureIDs);
+	Reader.Read(mostProbableIndex);
+
+	int32 NumTriggers = 0;
+	Reader.Read(NumTriggers);
+	for (int32 i = 0; i < NumTriggers && !Reader.bError; i++)
+	{
+		int32 Handle = INDEX_NONE;
+		int32 NumReached = 0;
+		Reader.Read(Handle);
+		Reader.Read(NumReached);
+
+		// triggers removed since the capture are ignored
+		for (FProgressTriggerState& State : progressTriggers)
+		{
+			if (State.Handle == Handle)
+				State.NumReached = FMath::Clamp(NumReached, 0, State.Trigger.Thresholds.Num());
+		}
+	}
+	Reader.Read(samplesSinceUpdate);
+	Reader.Read(timeSinceUpdate);
+
+	bool bResamplerHasPrevious = false;
+	FVector ResamplerPrevious = FVector::ZeroVector;
+	float ResamplerTimeToNextSample = 0.0f;
+	Reader.Read(bResamplerHasPrevious);
+	Reader.Read(ResamplerPrevious);
+	Reader.Read(ResamplerTimeToNextSample);
+	fixedRateResampler.SetResampleState(bResamplerHasPrevious, ResamplerPrevious, ResamplerTimeToNextSample);
+
+	Reader.Read(lastInputPoint);
+	Reader.Read(lastInputFeature);
+	Reader.Read(bHasLastInput);
+	Reader.Read(bMotionGateAsleep);
+	Reader.Read(motionGateStillTime);
+
+	bool bHasCurrentGesture = false;
+	Reader.Read(bHasCurrentGesture);
+	if (bHasCurrentGesture)
+	{
+		if (CurrentGesture == nullptr)
+		{
+			CurrentGesture = ListeningGesture;
+		}
+		Reader.Read(CurrentGesture->inputDimensions);
+		Reader.Read(CurrentGesture->featureDimensions);
+		Reader.Read(CurrentGesture->templateInitialObservation);
+		Reader.Read(CurrentGesture->templateInitialNormal);
+		Reader.Read(CurrentGesture->observationRangeMax);
+		Reader.Read(CurrentGesture->observationRangeMin);
+		Reader.ReadArray(CurrentGesture->templateRaw);
+		CurrentGesture->templateQuantised.Reset();
+		Reader.ReadArray(CurrentGesture->templateFeatures);
+		Reader.ReadArray(CurrentGesture->templateInitialFeature);
+		Reader.ReadArray(CurrentGesture->featureRangeMax);
+		Reader.ReadArray(CurrentGesture->featureRangeMin);
+	}
+
+	if (Reader.bError)
+	{
+		// the state is partially overwritten, start again from the prior
+		UE_LOG(VRGesturePluginLog, Error, TEXT("[%s::restoreSnapshot] Truncated snapshot, filter reinitialised"), *GetName());
+		if (CurrentGesture)
+			CurrentGesture->Reset();
+		train();
+		return false;
+	}
+
+	return true;
+}
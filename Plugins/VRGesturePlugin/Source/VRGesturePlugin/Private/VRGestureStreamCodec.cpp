@@ -0,0 +1,409 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRGesturePluginPrivatePCH.h"
+#include "VRGestureStreamCodec.h"
+#include "VRGestureRecognizer.h"
+#include "VRGestureAutoTuner.h"
+
+// Bits used by each axis width in a packet, widths go up to 32
+static const int32 WidthBits = 6;
+
+// LSB first bit packing, the byte array keeps its capacity
+struct FStreamBitWriter
+{
+	TArray<uint8>& Bytes;
+	uint64 Accumulator;
+	int32 NumBits;
+
+	FStreamBitWriter(TArray<uint8>& InBytes)
+		: Bytes(InBytes)
+		, Accumulator(0)
+		, NumBits(0)
+	{
+		Bytes.Reset();
+	}
+
+	void Write(uint32 Value, int32 Bits)
+	{
+		if (Bits == 0)
+			return;
+
+		uint64 Mask = (1ull << Bits) - 1;
+		Accumulator |= ((uint64)Value & Mask) << NumBits;
+		NumBits += Bits;
+		while (NumBits >= 8)
+		{
+			Bytes.Add((uint8)Accumulator);
+			Accumulator >>= 8;
+			NumBits -= 8;
+		}
+	}
+
+	void WriteFloat(float Value)
+	{
+		uint32 Bits;
+		FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+		Write(Bits, 32);
+	}
+
+	void Flush()
+	{
+		if (NumBits > 0)
+			Bytes.Add((uint8)Accumulator);
+		Accumulator = 0;
+		NumBits = 0;
+	}
+};
+
+struct FStreamBitReader
+{
+	const uint8* Data;
+	int32 NumBytes;
+	int32 ByteIndex;
+	uint64 Accumulator;
+	int32 NumBits;
+	bool bError;
+
+	FStreamBitReader(const uint8* InData, int32 InNumBytes)
+		: Data(InData)
+		, NumBytes(InNumBytes)
+		, ByteIndex(0)
+		, Accumulator(0)
+		, NumBits(0)
+		, bError(false)
+	{
+	}
+
+	uint32 Read(int32 Bits)
+	{
+		if (Bits == 0)
+			return 0;
+
+		while (NumBits < Bits)
+		{
+			if (ByteIndex >= NumBytes)
+			{
+				bError = true;
+				return 0;
+			}
+			Accumulator |= (uint64)Data[ByteIndex++] << NumBits;
+			NumBits += 8;
+		}
+
+		uint32 Value = (uint32)(Accumulator & ((1ull << Bits) - 1));
+		Accumulator >>= Bits;
+		NumBits -= Bits;
+		return Value;
+	}
+
+	float ReadFloat()
+	{
+		uint32 Bits = Read(32);
+		float Value;
+		FMemory::Memcpy(&Value, &Bits, sizeof(Value));
+		return Value;
+	}
+};
+
+// Small deltas of either sign map to small unsigned values
+static FORCEINLINE uint32 ZigZag(int32 Value)
+{
+	return ((uint32)Value << 1) ^ (uint32)(Value >> 31);
+}
+
+static FORCEINLINE int32 UnZigZag(uint32 Value)
+{
+	return (int32)(Value >> 1) ^ -(int32)(Value & 1);
+}
+
+static FORCEINLINE int32 BitWidth(uint32 Value)
+{
+	return 32 - FMath::CountLeadingZeros(Value);
+}
+
+//--------------------------------------------------------------
+FVRGestureStreamEncoder::FVRGestureStreamEncoder()
+{
+	SetFormat(FVRGestureStreamFormat(), FVector::ZeroVector, FVector(100.0f));
+}
+
+void FVRGestureStreamEncoder::SetFormat(const FVRGestureStreamFormat& InFormat, const FVector& RangeMin, const FVector& RangeMax)
+{
+	Format = InFormat;
+	Format.PrecisionBits = FMath::Clamp(Format.PrecisionBits, 4, 16);
+	Format.KeyInterval = FMath::Max(Format.KeyInterval, 1);
+
+	// a flat axis of the templates still gets a usable step
+	float Steps = (float)((1 << Format.PrecisionBits) - 1);
+	FVector Range = RangeMax - RangeMin;
+	Step = FVector(FMath::Max(Range.X / Steps, 0.001f), FMath::Max(Range.Y / Steps, 0.001f), FMath::Max(Range.Z / Steps, 0.001f));
+	InvStep = FVector(1.0f / Step.X, 1.0f / Step.Y, 1.0f / Step.Z);
+	Sequence = 0;
+	Reset();
+}
+
+void FVRGestureStreamEncoder::Reset()
+{
+	Origin = FVector::ZeroVector;
+	Last[0] = Last[1] = Last[2] = 0;
+	SamplesSinceKey = 0;
+	bHasKey = false;
+}
+
+void FVRGestureStreamEncoder::EncodePacket(const FVector* Samples, int32 NumSamples, float DeltaTime, TArray<uint8>& OutPacket)
+{
+	NumSamples = FMath::Clamp(NumSamples, 0, MaxSamplesPerPacket);
+
+	FStreamBitWriter Writer(OutPacket);
+	Writer.Write(Sequence++, 8);
+	Writer.Write(NumSamples, 8);
+	Writer.Write((uint32)FMath::Clamp(FMath::RoundToInt(DeltaTime * 10000.0f), 0, 65535), 16);
+	if (NumSamples == 0)
+	{
+		Writer.Flush();
+		return;
+	}
+
+	bool bKey = !bHasKey || SamplesSinceKey >= Format.KeyInterval;
+	Writer.Write(bKey ? 1 : 0, 1);
+
+	int32 First = 0;
+	if (bKey)
+	{
+		// positions are quantised relative to the key sample, which is sent exactly
+		Origin = Samples[0];
+		Last[0] = Last[1] = Last[2] = 0;
+		for (int32 Axis = 0; Axis < 3; Axis++)
+			Writer.WriteFloat(Origin[Axis]);
+		for (int32 Axis = 0; Axis < 3; Axis++)
+			Writer.WriteFloat(Step[Axis]);
+
+		bHasKey = true;
+		SamplesSinceKey = 0;
+		First = 1;
+	}
+
+	// first pass: smallest width covering the deltas of each axis
+	uint32 Widest[3] = { 0, 0, 0 };
+	int32 Previous[3] = { Last[0], Last[1], Last[2] };
+	for (int32 i = First; i < NumSamples; i++)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			int32 Quantised = FMath::RoundToInt((Samples[i][Axis] - Origin[Axis]) * InvStep[Axis]);
+			Widest[Axis] |= ZigZag(Quantised - Previous[Axis]);
+			Previous[Axis] = Quantised;
+		}
+	}
+
+	int32 Widths[3];
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		Widths[Axis] = BitWidth(Widest[Axis]);
+		Writer.Write(Widths[Axis], WidthBits);
+	}
+
+	// second pass: the deltas
+	for (int32 i = First; i < NumSamples; i++)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			int32 Quantised = FMath::RoundToInt((Samples[i][Axis] - Origin[Axis]) * InvStep[Axis]);
+			Writer.Write(ZigZag(Quantised - Last[Axis]), Widths[Axis]);
+			Last[Axis] = Quantised;
+		}
+	}
+
+	SamplesSinceKey += NumSamples;
+	Writer.Flush();
+}
+
+//--------------------------------------------------------------
+FVRGestureStreamDecoder::FVRGestureStreamDecoder()
+{
+	Reset();
+}
+
+void FVRGestureStreamDecoder::Reset()
+{
+	Step = FVector::ZeroVector;
+	Origin = FVector::ZeroVector;
+	Last[0] = Last[1] = Last[2] = 0;
+	ExpectedSequence = 0;
+	bHasKey = false;
+}
+
+int32 FVRGestureStreamDecoder::DecodePacket(const uint8* Packet, int32 NumBytes, FVector* OutSamples, int32 MaxSamples, float& OutDeltaTime)
+{
+	FStreamBitReader Reader(Packet, NumBytes);
+	uint8 Sequence = (uint8)Reader.Read(8);
+	int32 NumSamples = (int32)Reader.Read(8);
+	OutDeltaTime = Reader.Read(16) / 10000.0f;
+	if (Reader.bError)
+		return INDEX_NONE;
+
+	// a lost packet breaks the delta chain until the next key sample
+	if (Sequence != ExpectedSequence)
+		bHasKey = false;
+	ExpectedSequence = Sequence + 1;
+
+	if (NumSamples == 0)
+		return 0;
+
+	bool bKey = Reader.Read(1) != 0;
+	int32 First = 0;
+	if (bKey)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+			Origin[Axis] = Reader.ReadFloat();
+		for (int32 Axis = 0; Axis < 3; Axis++)
+			Step[Axis] = Reader.ReadFloat();
+		Last[0] = Last[1] = Last[2] = 0;
+		bHasKey = !Reader.bError;
+		First = 1;
+	}
+
+	if (!bHasKey || NumSamples > MaxSamples)
+		return INDEX_NONE;
+
+	if (bKey)
+		OutSamples[0] = Origin;
+
+	int32 Widths[3];
+	for (int32 Axis = 0; Axis < 3; Axis++)
+		Widths[Axis] = FMath::Min((int32)Reader.Read(WidthBits), 32);
+
+	for (int32 i = First; i < NumSamples; i++)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			Last[Axis] += UnZigZag(Reader.Read(Widths[Axis]));
+			OutSamples[i][Axis] = Origin[Axis] + Last[Axis] * Step[Axis];
+		}
+	}
+
+	if (Reader.bError)
+	{
+		bHasKey = false;
+		return INDEX_NONE;
+	}
+	return NumSamples;
+}
+
+int32 FVRGestureStreamDecoder::DecodeToRecognizer(const TArray<uint8>& Packet, UVRGestureRecognizer* Recognizer)
+{
+	FVector Samples[FVRGestureStreamEncoder::MaxSamplesPerPacket];
+	float DeltaTime = 0.0f;
+	int32 NumSamples = DecodePacket(Packet.GetData(), Packet.Num(), Samples, FVRGestureStreamEncoder::MaxSamplesPerPacket, DeltaTime);
+
+	for (int32 i = 0; i < NumSamples; i++)
+	{
+		Recognizer->Tick(Samples[i], DeltaTime);
+	}
+	return FMath::Max(NumSamples, 0);
+}
+
+//--------------------------------------------------------------
+FVRGestureStreamReport FVRGestureStreamCodec::Evaluate(const TArray<FVRGestureTrajectory>& Trajectories, const FVRGestureStreamFormat& Format, float SampleRate, int32 SamplesPerPacket)
+{
+	check(IsInGameThread());
+
+	FVRGestureStreamReport Report;
+	SamplesPerPacket = FMath::Clamp(SamplesPerPacket, 1, FVRGestureStreamEncoder::MaxSamplesPerPacket);
+	float DeltaTime = SampleRate > 0.0f ? 1.0f / SampleRate : 0.0f;
+
+	// the raw and the decoded stream go to identical recognizers
+	UVRGestureRecognizer* RawRecognizer = NewObject<UVRGestureRecognizer>();
+	UVRGestureRecognizer* StreamRecognizer = NewObject<UVRGestureRecognizer>();
+	RawRecognizer->AddToRoot();
+	StreamRecognizer->AddToRoot();
+	RawRecognizer->bBudgetManaged = false;
+	StreamRecognizer->bBudgetManaged = false;
+
+	// the templates are recorded once, then moved to a library of their own shared by both
+	// recognizers. Sharing freezes the library, the recognizers keep their own one untouched
+	UVRGestureTemplateManager* Library = NewObject<UVRGestureTemplateManager>();
+	Library->AddToRoot();
+
+	TArray<int32> TestIndices;
+	FVRGestureAutoTuner::RecordTemplates(RawRecognizer, Trajectories, TestIndices);
+	UVRGestureTemplateManager* Recorded = RawRecognizer->getTemplateLibrary();
+	for (auto& Elem : Recorded->GestureTemplates)
+	{
+		Library->AddNewGesture(Elem.Value);
+	}
+	Recorded->clear();
+	RawRecognizer->setTemplateLibrary(Library);
+	StreamRecognizer->setTemplateLibrary(Library);
+
+	FVector RangeMin, RangeMax;
+	if (!Library->GetRange(RangeMin, RangeMax))
+	{
+		RangeMin = FVector::ZeroVector;
+		RangeMax = FVector(100.0f);
+	}
+
+	FVRGestureStreamEncoder Encoder;
+	FVRGestureStreamDecoder Decoder;
+	Encoder.SetFormat(Format, RangeMin, RangeMax);
+
+	TArray<uint8> Packet;
+	FVector Decoded[FVRGestureStreamEncoder::MaxSamplesPerPacket];
+	int64 EncodedBytes = 0;
+	int32 NumSamples = 0;
+	int32 NumAgreements = 0;
+
+	for (int32 TestIndex : TestIndices)
+	{
+		const TArray<FVector>& Points = Trajectories[TestIndex].Points;
+		if (Points.Num() == 0)
+			continue;
+
+		Encoder.Reset();
+		Decoder.Reset();
+		RawRecognizer->setRandomSeed(TestIndex);
+		StreamRecognizer->setRandomSeed(TestIndex);
+		RawRecognizer->StartListening();
+		StreamRecognizer->StartListening();
+
+		for (int32 Start = 0; Start < Points.Num(); Start += SamplesPerPacket)
+		{
+			int32 Count = FMath::Min(SamplesPerPacket, Points.Num() - Start);
+			Encoder.EncodePacket(&Points[Start], Count, DeltaTime, Packet);
+			EncodedBytes += Packet.Num();
+
+			float DecodedDeltaTime = 0.0f;
+			int32 NumDecoded = Decoder.DecodePacket(Packet.GetData(), Packet.Num(), Decoded, FVRGestureStreamEncoder::MaxSamplesPerPacket, DecodedDeltaTime);
+			for (int32 i = 0; i < NumDecoded; i++)
+			{
+				FVector Point = Points[Start + i];
+				Report.MaxError = FMath::Max(Report.MaxError, FVector::Dist(Point, Decoded[i]));
+
+				RawRecognizer->Tick(Point, DeltaTime);
+				StreamRecognizer->Tick(Decoded[i], DecodedDeltaTime);
+				if (RawRecognizer->getMostProbableGesture() == StreamRecognizer->getMostProbableGesture())
+					NumAgreements++;
+				NumSamples++;
+			}
+		}
+
+		RawRecognizer->StopListening();
+		StreamRecognizer->StopListening();
+	}
+
+	RawRecognizer->RemoveFromRoot();
+	StreamRecognizer->RemoveFromRoot();
+	Library->RemoveFromRoot();
+
+	if (NumSamples > 0)
+	{
+		float Duration = NumSamples / FMath::Max(SampleRate, 1.0f);
+		Report.Agreement = (float)NumAgreements / (float)NumSamples;
+		Report.RawBytesPerSecond = NumSamples * sizeof(FVector) / Duration;
+		Report.EncodedBytesPerSecond = EncodedBytes / Duration;
+	}
+
+	UE_LOG(VRGesturePluginLog, Log, TEXT("[FVRGestureStreamCodec::Evaluate] %d samples: agreement %.3f, %.0f B/s raw, %.0f B/s encoded, max error %.3f"),
+		NumSamples, Report.Agreement, Report.RawBytesPerSecond, Report.EncodedBytesPerSecond, Report.MaxError);
+	return Report;
+}
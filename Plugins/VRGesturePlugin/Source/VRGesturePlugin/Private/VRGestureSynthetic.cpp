@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRGesturePluginPrivatePCH.h"
+#include "VRGestureSynthetic.h"
+#include "VRGestureAutoTuner.h"
+#include "RandomNumbers.h"
+
+// Harmonics summed on each axis of a gesture curve
+static const int32 NumHarmonics = 3;
+
+// Smooth open curve, starting at the origin
+struct FSyntheticShape
+{
+	float Amplitude[3][NumHarmonics];
+	float Frequency[3][NumHarmonics];
+	float Phase[3][NumHarmonics];
+
+	FSyntheticShape(RandomNumbers& RN, float Size)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			for (int32 k = 0; k < NumHarmonics; k++)
+			{
+				// lower harmonics dominate, so the curve stays smooth
+				Amplitude[Axis][k] = Size * (0.2f + 0.3f * RN.GetRandomUniform()) / (k + 1);
+				Frequency[Axis][k] = (0.25f + 1.25f * RN.GetRandomUniform()) * (k + 1);
+				Phase[Axis][k] = 2.0f * PI * RN.GetRandomUniform();
+			}
+		}
+	}
+
+	FVector Evaluate(float t) const
+	{
+		FVector Point;
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			float Value = 0.0f;
+			for (int32 k = 0; k < NumHarmonics; k++)
+			{
+				Value += Amplitude[Axis][k] * (FMath::Sin(2.0f * PI * Frequency[Axis][k] * t + Phase[Axis][k]) - FMath::Sin(Phase[Axis][k]));
+			}
+			Point[Axis] = Value;
+		}
+		return Point;
+	}
+};
+
+// Uniform in [-Range; Range]
+static float Spread(RandomNumbers& RN, float Range)
+{
+	return (RN.GetRandomUniform() * 2.0f - 1.0f) * Range;
+}
+
+void FVRGestureSynthetic::Generate(const FVRGestureSyntheticSet& Set, TArray<FVRGestureTrajectory>& OutTrajectories)
+{
+	int32 NumGestures = FMath::Max(Set.NumGestures, 1);
+	int32 TemplateLength = FMath::Max(Set.TemplateLength, 4);
+	float StepLength = 1.0f / (TemplateLength - 1);
+
+	// the progression of a query always moves forward, ClampMax only applies in the editor
+	float SpeedVariation = FMath::Clamp(Set.SpeedVariation, 0.0f, 0.9f);
+	float AccelerationVariation = FMath::Clamp(Set.AccelerationVariation, 0.0f, 0.9f);
+
+	TArray<FSyntheticShape> Shapes;
+	OutTrajectories.Reset();
+	OutTrajectories.Reserve(NumGestures * (1 + FMath::Max(Set.QueriesPerGesture, 0)));
+
+	// templates, one stream per gesture
+	for (int32 Gesture = 0; Gesture < NumGestures; Gesture++)
+	{
+		RandomNumbers RN(Set.Seed, Gesture);
+		Shapes.Add(FSyntheticShape(RN, Set.GestureSize));
+
+		FVRGestureTrajectory& Template = OutTrajectories[OutTrajectories.AddDefaulted()];
+		Template.GestureID = Gesture;
+		for (int32 i = 0; i < TemplateLength; i++)
+		{
+			Template.Points.Add(Shapes[Gesture].Evaluate(i * StepLength));
+		}
+	}
+
+	// queries, one stream per query so that changing a count does not change the others
+	for (int32 Query = 0; Query < Set.QueriesPerGesture; Query++)
+	{
+		for (int32 Gesture = 0; Gesture < NumGestures; Gesture++)
+		{
+			RandomNumbers RN(Set.Seed, NumGestures + Query * NumGestures + Gesture);
+
+			float Speed = 1.0f + Spread(RN, SpeedVariation);
+			float Acceleration = Spread(RN, AccelerationVariation);
+			FVector Scale(1.0f + Spread(RN, Set.ScaleVariation), 1.0f + Spread(RN, Set.ScaleVariation), 1.0f + Spread(RN, Set.ScaleVariation));
+			float Phi = Spread(RN, Set.RotationVariation);
+			float Theta = Spread(RN, Set.RotationVariation);
+			float Psi = Spread(RN, Set.RotationVariation);
+			FVector Offset(Spread(RN, Set.GestureSize), Spread(RN, Set.GestureSize), Spread(RN, Set.GestureSize));
+			int32 Onset = FMath::Min((int32)(RN.GetRandomUniform() * (Set.MaxOnset + 1)), Set.MaxOnset);
+			float NoiseSigma = Set.Noise * Set.GestureSize;
+
+			FVRGestureTrajectory& Trajectory = OutTrajectories[OutTrajectories.AddDefaulted()];
+			Trajectory.GestureID = Gesture;
+			Trajectory.Onset = Onset;
+
+			// idle hand at the start position, then the gesture with a progression speed
+			// changing linearly from Speed * (1 - Acceleration) to Speed * (1 + Acceleration)
+			float t = 0.0f;
+			int32 NumSamples = 0;
+			while (t <= 1.0f)
+			{
+				FVector Point = rotate3d(Shapes[Gesture].Evaluate(t) * Scale, Phi, Theta, Psi) + Offset;
+				Point += FVector(RN.GetRandomNormal(), RN.GetRandomNormal(), RN.GetRandomNormal()) * NoiseSigma;
+				Trajectory.Points.Add(Point);
+
+				if (++NumSamples > Onset)
+					t += StepLength * Speed * (1.0f + Acceleration * (2.0f * t - 1.0f));
+			}
+		}
+	}
+}
+
+void FVRGestureSynthetic::RunBenchmark(const FVRGestureSyntheticSet& Set, const FVRGestureTuningSpace& Space, TArray<FVRGestureTuningResult>& OutResults)
+{
+	TArray<FVRGestureTrajectory> Trajectories;
+	Generate(Set, Trajectories);
+
+	FVRGestureTuningTarget Target;
+	FVRGestureTuningResult Best;
+	FVRGestureAutoTuner::Tune(Trajectories, Space, Target, Best, &OutResults);
+
+	UE_LOG(VRGesturePluginLog, Log, TEXT("[FVRGestureSynthetic::RunBenchmark] %d gestures, %d queries, seed %d"), Set.NumGestures, Trajectories.Num() - Set.NumGestures, Set.Seed);
+	UE_LOG(VRGesturePluginLog, Log, TEXT("particles,tolerance,resampling,accuracy,latency_samples,cost_us"));
+	for (const FVRGestureTuningResult& Result : OutResults)
+	{
+		UE_LOG(VRGesturePluginLog, Log, TEXT("%d,%.4f,%d,%.4f,%.2f,%.2f"), Result.Parameters.numberParticles, Result.Parameters.tolerance,
+			Result.Parameters.resamplingThreshold, Result.Accuracy, Result.LatencySamples, Result.CostUs);
+	}
+}
+
+// vrgesture.Benchmark [QueriesPerGesture] [Seed]
+static void RunBenchmarkCommand(const TArray<FString>& Args)
+{
+	FVRGestureSyntheticSet Set;
+	if (Args.Num() > 0)
+		Set.QueriesPerGesture = FCString::Atoi(*Args[0]);
+	if (Args.Num() > 1)
+		Set.Seed = FCString::Atoi(*Args[1]);
+
+	TArray<FVRGestureTuningResult> Results;
+	FVRGestureSynthetic::RunBenchmark(Set, FVRGestureTuningSpace(), Results);
+}
+
+static FAutoConsoleCommand VRGestureBenchmarkCommand(
+	TEXT("vrgesture.Benchmark"),
+	TEXT("Recognize synthetic gestures with several particle counts and log accuracy, latency and cost.\n")
+	TEXT("Arguments: [QueriesPerGesture] [Seed]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunBenchmarkCommand));
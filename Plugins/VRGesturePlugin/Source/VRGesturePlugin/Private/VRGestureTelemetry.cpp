@@ -0,0 +1,421 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRGesturePluginPrivatePCH.h"
+#include "VRGestureTelemetry.h"
+
+static const uint32 TelemetryMagic = 0x54475256; // "VRGT"
+static const uint32 TelemetryVersion = 1;
+
+// Bytes of a frame before the gestures, size field excluded
+static const int32 FrameHeaderSize = 4 + 4 + 4 + 2 + 1 + 1 + 2;
+
+// Bytes of one gesture in a frame
+static const int32 FrameGestureSize = 4 + 4 + 4;
+
+// Gestures of a frame whose size still fits the uint16 size field
+static const int32 MaxFrameGestures = (MAX_uint16 - FrameHeaderSize - FVRGestureTelemetry::NumProgressionBins * 2) / FrameGestureSize;
+
+// Memory reserved for the pending frames, the writer usually keeps it well below
+static const int32 InitialBufferSize = 256 * 1024;
+
+// Time between two writes of the background thread (s)
+static const float WriteInterval = 0.05f;
+
+FVRGestureTelemetry* volatile FVRGestureTelemetry::Active = nullptr;
+FThreadSafeCounter FVRGestureTelemetry::NumUsers;
+
+// Background thread swapping the pending frames out and writing them to the file
+class FVRGestureTelemetry::FWriter : public FRunnable
+{
+public:
+
+	FWriter(FVRGestureTelemetry* InOwner, IFileHandle* InFile)
+		: Owner(InOwner)
+		, File(InFile)
+		, WakeEvent(FPlatformProcess::GetSynchEventFromPool(false))
+		, bStopping(false)
+	{
+		Pending.Reserve(InitialBufferSize);
+		Thread = FRunnableThread::Create(this, TEXT("VRGestureTelemetryWriter"), 0, TPri_BelowNormal);
+	}
+
+	~FWriter()
+	{
+		bStopping = true;
+		WakeEvent->Trigger();
+		if (Thread)
+		{
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+
+		// frames submitted after the last write
+		Flush();
+		delete File;
+	}
+
+	virtual uint32 Run() override
+	{
+		while (!bStopping)
+		{
+			WakeEvent->Wait(FTimespan::FromSeconds(WriteInterval));
+			Flush();
+		}
+		return 0;
+	}
+
+	void Flush()
+	{
+		{
+			FScopeLock Lock(&Owner->BufferLock);
+			Swap(Pending, Owner->Buffer);
+		}
+		if (Pending.Num() > 0)
+		{
+			File->Write(Pending.GetData(), Pending.Num());
+			Pending.Reset();
+		}
+	}
+
+private:
+
+	FVRGestureTelemetry* Owner;
+	IFileHandle* File;
+	FRunnableThread* Thread;
+	FEvent* WakeEvent;
+	TArray<uint8> Pending;
+	volatile bool bStopping;
+};
+
+FVRGestureTelemetry::FVRGestureTelemetry()
+	: StartTime(FPlatformTime::Seconds())
+	, Writer(nullptr)
+{
+	Buffer.Reserve(InitialBufferSize);
+}
+
+FVRGestureTelemetry::~FVRGestureTelemetry()
+{
+	delete Writer;
+}
+
+bool FVRGestureTelemetry::Start(const FString& Filename)
+{
+	Stop();
+
+	IFileHandle* File = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename);
+	if (!File)
+	{
+		UE_LOG(VRGesturePluginLog, Error, TEXT("[FVRGestureTelemetry::Start] Can not open %s"), *Filename);
+		return false;
+	}
+
+	uint32 Header[2] = { TelemetryMagic, TelemetryVersion };
+	File->Write((const uint8*)Header, sizeof(Header));
+
+	FVRGestureTelemetry* Telemetry = new FVRGestureTelemetry();
+	Telemetry->Writer = new FWriter(Telemetry, File);
+	FPlatformAtomics::InterlockedExchangePtr((void**)&Active, Telemetry);
+
+	UE_LOG(VRGesturePluginLog, Log, TEXT("[FVRGestureTelemetry::Start] Recording to %s"), *Filename);
+	return true;
+}
+
+void FVRGestureTelemetry::Stop()
+{
+	FVRGestureTelemetry* Telemetry = (FVRGestureTelemetry*)FPlatformAtomics::InterlockedExchangePtr((void**)&Active, nullptr);
+	if (!Telemetry)
+		return;
+
+	// recognizers ticking on other threads may still be submitting to it
+	while (NumUsers.GetValue() > 0)
+	{
+		FPlatformProcess::Sleep(0.0f);
+	}
+	delete Telemetry;
+
+	UE_LOG(VRGesturePluginLog, Log, TEXT("[FVRGestureTelemetry::Stop] Recording closed"));
+}
+
+FVRGestureTelemetry* FVRGestureTelemetry::Acquire()
+{
+	// counted first: once Stop has cleared Active, it waits for this access to end
+	NumUsers.Increment();
+	FVRGestureTelemetry* Telemetry = Active;
+	if (!Telemetry)
+		NumUsers.Decrement();
+	return Telemetry;
+}
+
+void FVRGestureTelemetry::Release()
+{
+	NumUsers.Decrement();
+}
+
+template <typename T>
+static FORCEINLINE void WriteValue(uint8*& Out, T Value)
+{
+	FMemory::Memcpy(Out, &Value, sizeof(T));
+	Out += sizeof(T);
+}
+
+void FVRGestureTelemetry::Submit(uint32 RecognizerID, float ESS, int32 NumParticles, bool bResampled, const TMap<int32, FVRGestureEstimate>& Estimates, const float* ProgressionMass)
+{
+	int32 NumGestures = FMath::Min(Estimates.Num(), MaxFrameGestures);
+	int32 FrameSize = FrameHeaderSize + NumGestures * FrameGestureSize + NumProgressionBins * 2;
+	float Time = (float)(FPlatformTime::Seconds() - StartTime);
+
+	FScopeLock Lock(&BufferLock);
+
+	// the frame is written in place, the buffer only grows if the writer falls behind
+	int32 Offset = Buffer.AddUninitialized(2 + FrameSize);
+	uint8* Out = Buffer.GetData() + Offset;
+
+	WriteValue<uint16>(Out, (uint16)FrameSize);
+	WriteValue<uint32>(Out, RecognizerID);
+	WriteValue<float>(Out, Time);
+	WriteValue<float>(Out, ESS);
+	WriteValue<uint16>(Out, (uint16)FMath::Min(NumParticles, (int32)MAX_uint16));
+	WriteValue<uint8>(Out, bResampled ? 1 : 0);
+	WriteValue<uint8>(Out, (uint8)NumProgressionBins);
+	WriteValue<uint16>(Out, (uint16)NumGestures);
+
+	int32 GestureCount = 0;
+	for (const auto& Elem : Estimates)
+	{
+		if (GestureCount++ == NumGestures)
+			break;
+		WriteValue<int32>(Out, Elem.Key);
+		WriteValue<float>(Out, Elem.Value.probability);
+		WriteValue<float>(Out, Elem.Value.alignment);
+	}
+
+	for (int32 Bin = 0; Bin < NumProgressionBins; Bin++)
+	{
+		WriteValue<uint16>(Out, (uint16)FMath::RoundToInt(FMath::Clamp(ProgressionMass[Bin], 0.0f, 1.0f) * MAX_uint16));
+	}
+}
+
+// Sequential reader of a recording, reads past the end return zeros and set bOverflow
+struct FTelemetryReader
+{
+	const TArray<uint8>& Bytes;
+	int32 Offset;
+	bool bOverflow;
+
+	FTelemetryReader(const TArray<uint8>& InBytes)
+		: Bytes(InBytes)
+		, Offset(0)
+		, bOverflow(false)
+	{
+	}
+
+	template <typename T>
+	T Read()
+	{
+		T Value = 0;
+		if (Offset + (int32)sizeof(T) > Bytes.Num())
+		{
+			bOverflow = true;
+			Offset = Bytes.Num();
+			return Value;
+		}
+		FMemory::Memcpy(&Value, Bytes.GetData() + Offset, sizeof(T));
+		Offset += sizeof(T);
+		return Value;
+	}
+
+	bool AtEnd() const
+	{
+		return Offset >= Bytes.Num();
+	}
+};
+
+struct FTelemetryFrame
+{
+	uint32 RecognizerID;
+	float Time;
+	float ESS;
+	int32 NumParticles;
+	bool bResampled;
+	TArray<int32> GestureIDs;
+	TArray<float> Masses;
+	TArray<float> Alignments;
+	TArray<float> Progression;
+};
+
+// Read the next frame, false at the end of the recording or on a truncated frame
+static bool ReadFrame(FTelemetryReader& Reader, FTelemetryFrame& Frame)
+{
+	if (Reader.AtEnd())
+		return false;
+
+	int32 FrameSize = Reader.Read<uint16>();
+	int32 FrameEnd = Reader.Offset + FrameSize;
+	if (FrameEnd > Reader.Bytes.Num())
+		return false;
+
+	Frame.RecognizerID = Reader.Read<uint32>();
+	Frame.Time = Reader.Read<float>();
+	Frame.ESS = Reader.Read<float>();
+	Frame.NumParticles = Reader.Read<uint16>();
+	Frame.bResampled = (Reader.Read<uint8>() & 1) != 0;
+	int32 NumBins = Reader.Read<uint8>();
+	int32 NumGestures = Reader.Read<uint16>();
+
+	Frame.GestureIDs.Reset();
+	Frame.Masses.Reset();
+	Frame.Alignments.Reset();
+	for (int32 i = 0; i < NumGestures; i++)
+	{
+		Frame.GestureIDs.Add(Reader.Read<int32>());
+		Frame.Masses.Add(Reader.Read<float>());
+		Frame.Alignments.Add(Reader.Read<float>());
+	}
+
+	Frame.Progression.Reset();
+	for (int32 Bin = 0; Bin < NumBins; Bin++)
+	{
+		Frame.Progression.Add(Reader.Read<uint16>() / (float)MAX_uint16);
+	}
+
+	// skip fields appended by later versions
+	Reader.Offset = FrameEnd;
+	return !Reader.bOverflow;
+}
+
+bool FVRGestureTelemetry::Decode(const FString& InFilename, const FString& OutFilename, bool bJson)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *InFilename))
+	{
+		UE_LOG(VRGesturePluginLog, Error, TEXT("[FVRGestureTelemetry::Decode] Can not read %s"), *InFilename);
+		return false;
+	}
+
+	FTelemetryReader Reader(Bytes);
+	if (Reader.Read<uint32>() != TelemetryMagic || Reader.Read<uint32>() != TelemetryVersion)
+	{
+		UE_LOG(VRGesturePluginLog, Error, TEXT("[FVRGestureTelemetry::Decode] %s is not a telemetry recording"), *InFilename);
+		return false;
+	}
+	int32 FramesOffset = Reader.Offset;
+
+	FString Text;
+	FTelemetryFrame Frame;
+	int32 NumFrames = 0;
+
+	if (bJson)
+	{
+		Text += TEXT("[\n");
+		while (ReadFrame(Reader, Frame))
+		{
+			Text += FString::Printf(TEXT("%s{\"frame\":%d,\"recognizer\":%u,\"time\":%.6f,\"ess\":%.3f,\"particles\":%d,\"resampled\":%s,\"gestures\":["),
+				NumFrames > 0 ? TEXT(",\n") : TEXT(""), NumFrames, Frame.RecognizerID, Frame.Time, Frame.ESS, Frame.NumParticles, Frame.bResampled ? TEXT("true") : TEXT("false"));
+			for (int32 i = 0; i < Frame.GestureIDs.Num(); i++)
+			{
+				Text += FString::Printf(TEXT("%s{\"id\":%d,\"mass\":%g,\"alignment\":%g}"), i > 0 ? TEXT(",") : TEXT(""), Frame.GestureIDs[i], Frame.Masses[i], Frame.Alignments[i]);
+			}
+			Text += TEXT("],\"progression\":[");
+			for (int32 Bin = 0; Bin < Frame.Progression.Num(); Bin++)
+			{
+				Text += FString::Printf(TEXT("%s%g"), Bin > 0 ? TEXT(",") : TEXT(""), Frame.Progression[Bin]);
+			}
+			Text += TEXT("]}");
+			NumFrames++;
+		}
+		Text += TEXT("\n]\n");
+	}
+	else
+	{
+		// first pass for the columns: every gesture seen in the recording
+		TArray<int32> Columns;
+		int32 NumBins = 0;
+		while (ReadFrame(Reader, Frame))
+		{
+			for (int32 GestureID : Frame.GestureIDs)
+				Columns.AddUnique(GestureID);
+			NumBins = FMath::Max(NumBins, Frame.Progression.Num());
+		}
+		Columns.Sort();
+
+		Text += TEXT("frame,recognizer,time,ess,particles,resampled");
+		for (int32 Bin = 0; Bin < NumBins; Bin++)
+			Text += FString::Printf(TEXT(",p%d"), Bin);
+		for (int32 GestureID : Columns)
+			Text += FString::Printf(TEXT(",mass%d,alignment%d"), GestureID, GestureID);
+		Text += TEXT("\n");
+
+		Reader.Offset = FramesOffset;
+		while (ReadFrame(Reader, Frame))
+		{
+			Text += FString::Printf(TEXT("%d,%u,%.6f,%.3f,%d,%d"), NumFrames, Frame.RecognizerID, Frame.Time, Frame.ESS, Frame.NumParticles, Frame.bResampled ? 1 : 0);
+			for (int32 Bin = 0; Bin < NumBins; Bin++)
+				Text += Frame.Progression.IsValidIndex(Bin) ? FString::Printf(TEXT(",%g"), Frame.Progression[Bin]) : FString(TEXT(","));
+			for (int32 GestureID : Columns)
+			{
+				int32 Index = Frame.GestureIDs.Find(GestureID);
+				Text += Index != INDEX_NONE ? FString::Printf(TEXT(",%g,%g"), Frame.Masses[Index], Frame.Alignments[Index]) : FString(TEXT(",,"));
+			}
+			Text += TEXT("\n");
+			NumFrames++;
+		}
+	}
+
+	if (!Reader.AtEnd())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[FVRGestureTelemetry::Decode] %s is truncated, the last frame is dropped"), *InFilename);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Text, *OutFilename))
+	{
+		UE_LOG(VRGesturePluginLog, Error, TEXT("[FVRGestureTelemetry::Decode] Can not write %s"), *OutFilename);
+		return false;
+	}
+
+	UE_LOG(VRGesturePluginLog, Log, TEXT("[FVRGestureTelemetry::Decode] %d frames written to %s"), NumFrames, *OutFilename);
+	return true;
+}
+
+// vrgesture.TelemetryStart [Filename]
+static void TelemetryStartCommand(const TArray<FString>& Args)
+{
+	FString Filename = Args.Num() > 0 ? Args[0] : FPaths::GameSavedDir() / TEXT("VRGestureTelemetry.bin");
+	FVRGestureTelemetry::Start(Filename);
+}
+
+static void TelemetryStopCommand(const TArray<FString>& Args)
+{
+	FVRGestureTelemetry::Stop();
+}
+
+// vrgesture.TelemetryDecode <Filename> [json]
+static void TelemetryDecodeCommand(const TArray<FString>& Args)
+{
+	if (Args.Num() < 1)
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[FVRGestureTelemetry::Decode] Usage: vrgesture.TelemetryDecode <Filename> [json]"));
+		return;
+	}
+
+	bool bJson = Args.Num() > 1 && Args[1] == TEXT("json");
+	FVRGestureTelemetry::Decode(Args[0], FPaths::ChangeExtension(Args[0], bJson ? TEXT("json") : TEXT("csv")), bJson);
+}
+
+static FAutoConsoleCommand VRGestureTelemetryStartCommand(
+	TEXT("vrgesture.TelemetryStart"),
+	TEXT("Record the particle filter internals of every listening recognizer to a binary file.\n")
+	TEXT("Arguments: [Filename], Saved/VRGestureTelemetry.bin by default"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&TelemetryStartCommand));
+
+static FAutoConsoleCommand VRGestureTelemetryStopCommand(
+	TEXT("vrgesture.TelemetryStop"),
+	TEXT("Flush and close the telemetry recording."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&TelemetryStopCommand));
+
+static FAutoConsoleCommand VRGestureTelemetryDecodeCommand(
+	TEXT("vrgesture.TelemetryDecode"),
+	TEXT("Convert a telemetry recording to CSV, or JSON, next to it.\n")
+	TEXT("Arguments: <Filename> [json]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&TelemetryDecodeCommand));
@@ -8,10 +8,144 @@ UVRGestureTemplate::UVRGestureTemplate()
 	:Super()
 {
 	inputDimensions = 3;
-	templateNormal = TArray<FVector>();
 	templateRaw = TArray<FVector>();
 
 	setAutoAdjustRanges(true);
 
 	Reset();
+}
+
+void UVRGestureTemplate::quantise()
+{
+	// released samples: the compact form is the only one left
+	if (isReleased())
+		return;
+
+	if (!hasSampleRange())
+		computeSampleRange();
+
+	// the sample range maps to [-32767; 32767], the template's own extent keeps the step small
+	quantiseOrigin = (sampleRangeMax + sampleRangeMin) * 0.5f;
+	quantiseStep = (sampleRangeMax - sampleRangeMin) / (2.0f * MAX_int16);
+	FVector InvStep;
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		InvStep[Axis] = quantiseStep[Axis] > 0.0f ? 1.0f / quantiseStep[Axis] : 0.0f;
+	}
+
+	templateQuantised.SetNumUninitialized(templateRaw.Num() * 3, false);
+	int16* Quantised = templateQuantised.GetData();
+	for (const FVector& Sample : templateRaw)
+	{
+		FVector Offset = (Sample - quantiseOrigin) * InvStep;
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			*Quantised++ = (int16)FMath::Clamp(FMath::RoundToInt(Offset[Axis]), -MAX_int16, (int32)MAX_int16);
+		}
+	}
+}
+
+// Distance from a point to the segment [A;B]
+static float DistanceToSegment(const FVector& Point, const FVector& A, const FVector& B)
+{
+	FVector AB = B - A;
+	float LengthSquared = AB.SizeSquared();
+	if (LengthSquared <= SMALL_NUMBER)
+		return FVector::Dist(Point, A);
+
+	float t = FMath::Clamp(FVector::DotProduct(Point - A, AB) / LengthSquared, 0.0f, 1.0f);
+	return FVector::Dist(Point, A + AB * t);
+}
+
+FVRGestureSimplifyReport UVRGestureTemplate::simplify(float IdleDistance, float Tolerance)
+{
+	FVRGestureSimplifyReport Report;
+	int32 Length = getTemplateLength();
+	Report.RecordedLength = Length;
+	Report.SimplifiedLength = Length;
+
+	// released templates are read-only, their full precision samples are gone
+	if (isReleased())
+		return Report;
+
+	// N-D templates are kept as recorded, the tolerance is defined on positions
+	if (Length < 3 || templateTimes.Num() > 0 || featureDimensions > 0)
+		return Report;
+
+	// trim the idle samples around the first and the last sample
+	int32 First = 0;
+	while (First < Length - 2 && FVector::Dist(templateRaw[First + 1], templateRaw[0]) <= IdleDistance)
+		First++;
+	int32 Last = Length - 1;
+	while (Last > First + 1 && FVector::Dist(templateRaw[Last - 1], templateRaw[Length - 1]) <= IdleDistance)
+		Last--;
+
+	Report.TrimmedHead = First;
+	Report.TrimmedTail = Length - 1 - Last;
+
+	// Douglas-Peucker on the remaining path
+	int32 Duration = Last - First + 1;
+	TArray<bool> Keep;
+	Keep.Init(false, Duration);
+	Keep[0] = true;
+	Keep[Duration - 1] = true;
+
+	TArray<FIntPoint> Segments;
+	Segments.Add(FIntPoint(0, Duration - 1));
+	while (Segments.Num() > 0)
+	{
+		FIntPoint Segment = Segments.Pop(false);
+		const FVector& A = templateRaw[First + Segment.X];
+		const FVector& B = templateRaw[First + Segment.Y];
+
+		float MaxDistance = 0.0f;
+		int32 MaxIndex = -1;
+		for (int32 i = Segment.X + 1; i < Segment.Y; i++)
+		{
+			float Distance = DistanceToSegment(templateRaw[First + i], A, B);
+			if (Distance > MaxDistance)
+			{
+				MaxDistance = Distance;
+				MaxIndex = i;
+			}
+		}
+
+		if (MaxIndex >= 0 && MaxDistance > Tolerance)
+		{
+			Keep[MaxIndex] = true;
+			Segments.Add(FIntPoint(Segment.X, MaxIndex));
+			Segments.Add(FIntPoint(MaxIndex, Segment.Y));
+		}
+	}
+
+	// rebuild the template relative to its new first sample, keeping the timing of each sample
+	FVector Origin = templateRaw[First];
+	TArray<FVector> Simplified;
+	templateTimes.Reset();
+	for (int32 i = 0; i < Duration; i++)
+	{
+		if (Keep[i])
+		{
+			Simplified.Add(templateRaw[First + i] - Origin);
+			templateTimes.Add((float)i / (float)Duration);
+		}
+	}
+	templateRaw = MoveTemp(Simplified);
+	templateDuration = Duration;
+	templateInitialObservation += Origin;
+	coarseDirections.Empty();
+
+	observationRangeMax = FVector(-INFINITY);
+	observationRangeMin = FVector(INFINITY);
+	sampleRangeMax = FVector(-INFINITY);
+	sampleRangeMin = FVector(INFINITY);
+	for (FVector& Sample : templateRaw)
+	{
+		ClampObservation(Sample);
+	}
+	normalise();
+
+	Report.SimplifiedLength = templateRaw.Num();
+	Report.CompressionRatio = (float)Report.RecordedLength / (float)FMath::Max(Report.SimplifiedLength, 1);
+	return Report;
 }
\ No newline at end of file
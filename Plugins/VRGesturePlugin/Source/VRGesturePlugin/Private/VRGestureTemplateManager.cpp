@@ -6,12 +6,44 @@
 
 
 
-void UVRGestureTemplateManager::InitEstimates()
+bool UVRGestureTemplateManager::Freeze(int32 NumCoarseDirections)
 {
+	// recognizers compare every template with the same kernel
+	if (!HasUniformFeatureDimensions())
+	{
+		UE_LOG(VRGesturePluginLog, Warning, TEXT("[%s::Freeze] Templates have different feature dimensions, the library can not be shared"), *GetName());
+		return false;
+	}
+
+	FVector MinRange(INFINITY);
+	FVector MaxRange(-INFINITY);
+	for (auto& Elem : GestureTemplates)
+	{
+		if (!Elem.Value->hasSampleRange())
+			Elem.Value->computeSampleRange();
+		MinRange = MinRange.ComponentMin(Elem.Value->sampleRangeMin);
+		MaxRange = MaxRange.ComponentMax(Elem.Value->sampleRangeMax);
+	}
+
 	for (auto& Elem : GestureTemplates)
 	{
-		Elem.Value->InitEstimates(GestureTemplates.Num());
+		Elem.Value->setRange(MinRange, MaxRange);
+		Elem.Value->buildCoarseDirections(FMath::Max(NumCoarseDirections, 1));
+	}
+
+	BuildSpatialIndex();
+	bReadOnly = true;
+
+	// only the compact samples are read from now on. The editor keeps full precision,
+	// a library asset may still be edited and saved there
+	if (!GIsEditor)
+	{
+		for (auto& Elem : GestureTemplates)
+		{
+			Elem.Value->releaseRawSamples();
+		}
 	}
+	return true;
 }
 
 bool UVRGestureTemplateManager::IsValidGestureID(int32 GestureID)
@@ -21,7 +53,7 @@ bool UVRGestureTemplateManager::IsValidGestureID(int32 GestureID)
 
 bool UVRGestureTemplateManager::AddNewGesture(UVRGestureTemplate* CurrentGesture)
 {
-	if (GestureTemplates.Contains(CurrentGesture->GestureID))
+	if (bReadOnly || GestureTemplates.Contains(CurrentGesture->GestureID))
 		return false;
 
 	if (GestureTemplates.Add(CurrentGesture->GestureID, CurrentGesture) == NULL)
@@ -29,6 +61,8 @@ bool UVRGestureTemplateManager::AddNewGesture(UVRGestureTemplate* CurrentGesture
 		return false;
 	}
 
+	bSpatialIndexDirty = true;
+
 	return true; 
 }
 
@@ -37,11 +71,120 @@ float UVRGestureTemplateManager::GetTemplateLength(int32 GestureID)
 	UVRGestureTemplate* Gesture = *GestureTemplates.Find(GestureID); 
 	if (Gesture)
 	{
-		return Gesture->getTemplateLength();
+		return Gesture->getTemplateDuration();
 	}
 	return 0; 
 }
 
+FIntVector UVRGestureTemplateManager::GetSpatialCell(const FVector& Observation) const
+{
+	FVector Normal = Observation * SpatialInvRange / SpatialIndexCellSize;
+	return FIntVector(FMath::FloorToInt(Normal.X), FMath::FloorToInt(Normal.Y), FMath::FloorToInt(Normal.Z));
+}
+
+void UVRGestureTemplateManager::BuildSpatialIndex()
+{
+	SpatialSamples.Reset();
+	SpatialCells.Reset();
+	bSpatialIndexDirty = false;
+
+	if (GestureTemplates.Num() == 0)
+		return;
+
+	// every template shares the global range once recorded
+	UVRGestureTemplate* FirstTemplate = GestureTemplates.CreateIterator().Value();
+	FVector Range = FirstTemplate->getMaxRange() - FirstTemplate->getMinRange();
+	SpatialInvRange = FVector(1.0f / FMath::Max(Range.X, KINDA_SMALL_NUMBER), 1.0f / FMath::Max(Range.Y, KINDA_SMALL_NUMBER), 1.0f / FMath::Max(Range.Z, KINDA_SMALL_NUMBER));
+
+	for (auto& Elem : GestureTemplates)
+	{
+		int32 Length = Elem.Value->getTemplateLength();
+		for (int32 i = 0; i < Length; i++)
+		{
+			FSpatialSample Sample;
+			Sample.Cell = GetSpatialCell(Elem.Value->getSample(i));
+			Sample.GestureID = Elem.Key;
+			Sample.Progression = Elem.Value->getSampleTime(i);
+			SpatialSamples.Add(Sample);
+		}
+	}
+
+	SpatialSamples.Sort([](const FSpatialSample& A, const FSpatialSample& B)
+	{
+		if (A.Cell.X != B.Cell.X) return A.Cell.X < B.Cell.X;
+		if (A.Cell.Y != B.Cell.Y) return A.Cell.Y < B.Cell.Y;
+		return A.Cell.Z < B.Cell.Z;
+	});
+
+	for (int32 i = 0; i < SpatialSamples.Num(); i++)
+	{
+		FIntPoint& CellRange = SpatialCells.FindOrAdd(SpatialSamples[i].Cell);
+		if (CellRange.Y == 0)
+			CellRange.X = i;
+		CellRange.Y++;
+	}
+}
+
+bool UVRGestureTemplateManager::ProposeFromObservation(const FVector& Observation, const TArray<int32>& AllowedIDs, float RandomValue, int32& OutGestureID, float& OutProgression)
+{
+	if (bSpatialIndexDirty)
+		BuildSpatialIndex();
+
+	FIntVector Center = GetSpatialCell(Observation);
+
+	// first pass counts the eligible samples, second pass picks one of them
+	int32 Count = 0;
+	int32 Selected = -1;
+	for (int32 Pass = 0; Pass < 2; Pass++)
+	{
+		int32 Index = 0;
+		for (int32 dx = -1; dx <= 1; dx++)
+		for (int32 dy = -1; dy <= 1; dy++)
+		for (int32 dz = -1; dz <= 1; dz++)
+		{
+			const FIntPoint* CellRange = SpatialCells.Find(Center + FIntVector(dx, dy, dz));
+			if (!CellRange)
+				continue;
+
+			for (int32 i = CellRange->X; i < CellRange->X + CellRange->Y; i++)
+			{
+				const FSpatialSample& Sample = SpatialSamples[i];
+				if (AllowedIDs.Num() > 0 && !AllowedIDs.Contains(Sample.GestureID))
+					continue;
+
+				if (Pass == 1 && Index == Selected)
+				{
+					OutGestureID = Sample.GestureID;
+					OutProgression = Sample.Progression;
+					return true;
+				}
+				Index++;
+			}
+		}
+
+		if (Pass == 0)
+		{
+			Count = Index;
+			if (Count == 0)
+				return false;
+			Selected = FMath::Min((int32)(RandomValue * Count), Count - 1);
+		}
+	}
+	return false;
+}
+
+float UVRGestureTemplateManager::GetTemplateLengthAtRate(int32 GestureID, float SampleRate)
+{
+	UVRGestureTemplate** Gesture = GestureTemplates.Find(GestureID);
+	if (Gesture && *Gesture)
+	{
+		float Duration = (*Gesture)->getTemplateDuration();
+		float TemplateRate = (*Gesture)->templateSampleRate;
+		return TemplateRate > 0.0f ? Duration * SampleRate / TemplateRate : Duration;
+	}
+	return 0;
+}
+
 int32 UVRGestureTemplateManager::GetGestureIDFromParticleIndex(int32 ParticleIndex)
 {
 	int32 NewIndex = ParticleIndex % GestureTemplates.Num(); 
@@ -3,13 +3,42 @@
 #pragma once
 
 
-
+/**
+* Random numbers of a recognizer
+* @details PCG32 generator (O'Neill 2014): 16 bytes of state, plus the spare normal of the
+* Box-Muller transform. The state is plain data so it can be copied into snapshots and
+* restored to replay the exact same sequence
+*/
 class RandomNumbers {
 
 public:
+	// Complete generator state
+	struct FState
+	{
+		uint64 State;
+		uint64 Increment;
+		float  SpareNormal;
+		uint32 bHasSpareNormal;
+	};
+
+	// Seeded from the clock, every generator gets its own stream
 	RandomNumbers();
 
+	RandomNumbers(uint64 Seed, uint64 Stream);
+
+	void SetSeed(uint64 Seed, uint64 Stream = 0);
+
+	// Uniform in [0;1[
 	float GetRandomUniform();
 
+	// Standard normal distribution
 	float GetRandomNormal();
-};
\ No newline at end of file
+
+	const FState& GetState() const { return State; }
+	void SetState(const FState& InState) { State = InState; }
+
+private:
+	uint32 Next();
+
+	FState State;
+};
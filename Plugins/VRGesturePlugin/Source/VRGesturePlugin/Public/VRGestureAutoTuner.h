@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "VRGestureTypes.h"
+
+class UVRGestureRecognizer;
+
+/**
+* Offline search of the cheapest engine parameters meeting a recognition target
+* @details the first trajectory of each gesture is recorded as its template, the other
+* trajectories are recognized with every configuration of the tuning space. Configurations
+* are evaluated in parallel, one recognizer each. Among the configurations meeting the
+* accuracy and latency target, the one with the lowest cost per tick is selected
+*/
+class VRGESTUREPLUGIN_API FVRGestureAutoTuner
+{
+public:
+
+	/**
+	* Search the tuning space, must be called from the game thread
+	* @param Trajectories labelled recordings, at least one per gesture
+	* @param Space candidate values of the parameters
+	* @param Target accuracy and latency to reach
+	* @param OutBest cheapest configuration meeting the target, or the most accurate one
+	* @param OutAll optional result of every configuration, in evaluation order
+	* @return true if a configuration meets the target
+	*/
+	static bool Tune(const TArray<FVRGestureTrajectory>& Trajectories, const FVRGestureTuningSpace& Space, const FVRGestureTuningTarget& Target,
+		FVRGestureTuningResult& OutBest, TArray<FVRGestureTuningResult>* OutAll = nullptr);
+
+	/**
+	* Record the first trajectory of each gesture as a template
+	* @param Recognizer idle recognizer receiving the templates
+	* @param Trajectories labelled recordings
+	* @param OutTestIndices indices of the trajectories which are not templates
+	*/
+	static void RecordTemplates(UVRGestureRecognizer* Recognizer, const TArray<FVRGestureTrajectory>& Trajectories, TArray<int32>& OutTestIndices);
+
+	/**
+	* Recognize trajectories with the current configuration of a recognizer
+	* @details a trajectory is recognized if its gesture is the most probable one from some
+	* sample until the end, the latency is the progression of that sample. Safe to call from
+	* worker threads for different recognizers
+	* @param Recognizer idle recognizer holding the templates, not managed by the budget scheduler
+	* @param Trajectories labelled recordings
+	* @param TestIndices trajectories to recognize
+	* @param Target accuracy and latency to reach
+	* @return accuracy, latency and cost of the configuration
+	*/
+	static FVRGestureTuningResult Evaluate(UVRGestureRecognizer* Recognizer, const TArray<FVRGestureTrajectory>& Trajectories, const TArray<int32>& TestIndices, const FVRGestureTuningTarget& Target);
+};
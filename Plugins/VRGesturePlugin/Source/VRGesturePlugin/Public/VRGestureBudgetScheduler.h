@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Tickable.h"
+
+DECLARE_STATS_GROUP(TEXT("VRGesture"), STATGROUP_VRGesture, STATCAT_Advanced);
+
+class UVRGestureRecognizer;
+
+/**
+* Keeps the total cost of the listening recognizers under a per-frame budget
+* @details every frame, the measured cost of each registered recognizer is summed. Above the
+* budget (vrgesture.FrameBudgetUs) the lowest priority recognizer is throttled one level, below
+* 75% of the budget the highest priority throttled recognizer is relaxed one level. Decisions
+* are spaced by a few frames so the averaged costs can settle. Use "stat VRGesture" to inspect.
+*/
+class VRGESTUREPLUGIN_API FVRGestureBudgetScheduler : public FTickableGameObject
+{
+public:
+
+	static FVRGestureBudgetScheduler& Get();
+	static void Shutdown();
+
+	void Register(UVRGestureRecognizer* Recognizer);
+	void Unregister(UVRGestureRecognizer* Recognizer);
+
+	/**
+	* Set the frame budget for all the recognizers
+	* @param Microseconds budget per frame, 0 disables throttling
+	*/
+	void SetFrameBudget(float Microseconds);
+	float GetFrameBudget() const;
+
+	// Total averaged cost per frame of the registered recognizers, in microseconds
+	float GetMeasuredCost() const { return MeasuredCost; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return Recognizers.Num() > 0; }
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	FVRGestureBudgetScheduler();
+
+	TArray< TWeakObjectPtr<UVRGestureRecognizer> > Recognizers;
+
+	float MeasuredCost;
+	int32 FramesSinceDecision;
+
+	static FVRGestureBudgetScheduler* Instance;
+};
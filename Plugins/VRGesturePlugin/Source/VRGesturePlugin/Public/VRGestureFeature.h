@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Largest number of dimensions of a gesture feature (e.g. finger joints)
+#define VRGESTURE_MAX_FEATURE_DIMENSIONS 32
+
+/**
+* Fixed size feature vector
+* @details the size is known at compile time so the recognizer kernels working on it are
+* fully unrolled. Positions keep using FVector, this is for orientations, velocities,
+* finger joints or any combination of them
+*/
+template <int32 Dim>
+struct TVRGestureFeature
+{
+	static_assert(Dim > 0 && Dim <= VRGESTURE_MAX_FEATURE_DIMENSIONS, "Unsupported gesture feature dimension");
+
+	enum { NumDimensions = Dim };
+
+	float Data[Dim];
+
+	TVRGestureFeature()
+	{
+		for (int32 k = 0; k < Dim; k++)
+			Data[k] = 0.0f;
+	}
+
+	explicit TVRGestureFeature(const float* InData)
+	{
+		for (int32 k = 0; k < Dim; k++)
+			Data[k] = InData[k];
+	}
+
+	FORCEINLINE float& operator[](int32 Index) { return Data[Index]; }
+	FORCEINLINE float operator[](int32 Index) const { return Data[Index]; }
+};
+
+//--------------------------------------------------------------
+// Weighted squared euclidean distance sum(w * (a - b)^2) of two Dim-dimensional features.
+// The trip count is a compile time constant: the loop is split on 4 independent
+// accumulators so the compiler unrolls it and maps it to SIMD registers.
+template <int32 Dim>
+FORCEINLINE float WeightedSquaredDistance(const float* RESTRICT A, const float* RESTRICT B, const float* RESTRICT W)
+{
+	float Sum0 = 0.0f, Sum1 = 0.0f, Sum2 = 0.0f, Sum3 = 0.0f;
+	int32 k = 0;
+	for (; k + 4 <= Dim; k += 4)
+	{
+		const float D0 = A[k] - B[k];
+		const float D1 = A[k + 1] - B[k + 1];
+		const float D2 = A[k + 2] - B[k + 2];
+		const float D3 = A[k + 3] - B[k + 3];
+		Sum0 += W[k] * D0 * D0;
+		Sum1 += W[k + 1] * D1 * D1;
+		Sum2 += W[k + 2] * D2 * D2;
+		Sum3 += W[k + 3] * D3 * D3;
+	}
+	for (; k < Dim; k++)
+	{
+		const float D = A[k] - B[k];
+		Sum0 += W[k] * D * D;
+	}
+	return (Sum0 + Sum1) + (Sum2 + Sum3);
+}
+
+// 2-D and 3-D are the hot paths of position gestures: plain scalar code, no loop
+template <>
+FORCEINLINE float WeightedSquaredDistance<2>(const float* RESTRICT A, const float* RESTRICT B, const float* RESTRICT W)
+{
+	const float DX = A[0] - B[0];
+	const float DY = A[1] - B[1];
+	return W[0] * DX * DX + W[1] * DY * DY;
+}
+
+template <>
+FORCEINLINE float WeightedSquaredDistance<3>(const float* RESTRICT A, const float* RESTRICT B, const float* RESTRICT W)
+{
+	const float DX = A[0] - B[0];
+	const float DY = A[1] - B[1];
+	const float DZ = A[2] - B[2];
+	return W[0] * DX * DX + W[1] * DY * DY + W[2] * DZ * DZ;
+}
+
+template <int32 Dim>
+FORCEINLINE float WeightedSquaredDistance(const TVRGestureFeature<Dim>& A, const TVRGestureFeature<Dim>& B, const TVRGestureFeature<Dim>& W)
+{
+	return WeightedSquaredDistance<Dim>(A.Data, B.Data, W.Data);
+}
+
+// Distance kernel instantiated for one dimension
+typedef float(*FVRGestureDistanceKernel)(const float* A, const float* B, const float* W);
+
+/**
+* Get the distance kernel instantiated for a number of dimensions
+* @param NumDimensions feature dimension [1;VRGESTURE_MAX_FEATURE_DIMENSIONS]
+* @return the kernel, nullptr if the dimension is not supported
+*/
+VRGESTUREPLUGIN_API FVRGestureDistanceKernel GetDistanceKernel(int32 NumDimensions);
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "VRGestureTypes.h"
+
+/**
+* Streaming preprocessing of the controller input, applied identically when recording and listening
+* @details stages, in order: one-euro low-pass filter, resampling at a fixed interval and feature
+* extraction (position, velocity or acceleration). Positions are processed one after the other,
+* the three axes of each in the lanes of one SIMD register, and the pipeline never allocates:
+* outputs are written to a caller provided buffer.
+*/
+class VRGESTUREPLUGIN_API FVRGestureInputPipeline
+{
+public:
+
+	// Maximum number of samples produced for one input sample
+	static const int32 MaxOutputsPerSample = 8;
+
+	FVRGestureInputPipeline();
+
+	void SetConfig(const FVRGestureInputPipelineConfig& InConfig);
+
+	// Restart the filters, the next input becomes the first sample
+	void Reset();
+
+	/**
+	* Process a block of input samples
+	* @param Positions input positions, regularly spaced by DeltaTime
+	* @param NumPositions number of input positions
+	* @param DeltaTime time between two input positions (s)
+	* @param OutSamples output samples (features)
+	* @param OutDeltaTimes time covered by each output sample (s)
+	* @param MaxOutputs capacity of the output buffers. Once full, the time of the samples that
+	* do not fit is added to the last output, so the output times always add up to the input time
+	* @param OutNumDropped if not null, receives the number of samples that did not fit
+	* @return number of output samples written
+	*/
+	int32 ProcessBlock(const FVector* Positions, int32 NumPositions, float DeltaTime, FVector* OutSamples, float* OutDeltaTimes, int32 MaxOutputs, int32* OutNumDropped = nullptr);
+
+	// Resampling state, saved in the recognizer snapshots
+	void GetResampleState(bool& bOutHasPrevious, FVector& OutPrevious, float& OutTimeToNextSample) const;
+	void SetResampleState(bool bInHasPrevious, const FVector& InPrevious, float InTimeToNextSample);
+
+private:
+
+	FVector OneEuro(const FVector& Position, float DeltaTime);
+	bool ExtractFeature(const FVector& Position, float DeltaTime, FVector& OutFeature);
+
+	FVRGestureInputPipelineConfig Config;
+
+	// one-euro state
+	bool bHasFiltered;
+	FVector Filtered;
+	FVector FilteredDerivative;
+
+	// resampling state
+	bool bHasPrevious;
+	FVector Previous;
+	float TimeToNextSample;
+
+	// feature state
+	int32 NumFeatureSamples;
+	FVector LastPosition;
+	FVector LastVelocity;
+};
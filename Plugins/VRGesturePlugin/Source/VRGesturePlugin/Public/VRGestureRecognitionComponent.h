@@ -4,11 +4,13 @@
 
 #include "VRGestureTypes.h"
 #include "VRGestureRecognizer.h"
+#include "VRGestureInputPipeline.h"
+#include "VRGestureStreamCodec.h"
 #include "Components/SceneComponent.h"
 #include "VRGestureRecognitionComponent.generated.h"
 
 
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnNewGestureData, FVRGROutcomes, Outcomes);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnNewGestureData, const FVRGROutcomes&, Outcomes);
 
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class VRGESTUREPLUGIN_API UVRGestureRecognitionComponent : public USceneComponent
@@ -28,6 +30,57 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = Gesture)
 		FString TemplateFilePath = "None";
 
+	// Filtering, resampling and features applied to the input, identical when recording and listening
+	UPROPERTY(EditAnywhere, Category = Gesture)
+		FVRGestureInputPipelineConfig InputPipeline;
+
+	// Rate (Hz) the recognizer runs at whatever the frame rate, 0 to update at every frame.
+	// Replaces the resampling of InputPipeline, leave it off when this is set
+	UPROPERTY(EditAnywhere, Category = Gesture, meta = (ClampMin = "0"))
+		float FixedRate;
+
+	// Same outcomes for the same input on any number of threads, for regression tests and replays
+	UPROPERTY(EditAnywhere, Category = Gesture)
+		bool bDeterministic;
+
+	UPROPERTY(EditAnywhere, Category = Gesture, meta = (EditCondition = "bDeterministic"))
+		int32 DeterministicSeed;
+
+	// Suspends recognition while the controller is still
+	UPROPERTY(EditAnywhere, Category = Gesture)
+		FVRGestureMotionGate MotionGate;
+
+	// Cheap matcher limiting the particle filter to the plausible gestures
+	UPROPERTY(EditAnywhere, Category = Gesture)
+		FVRGesturePrefilter Prefilter;
+
+	// Trims and simplifies the recorded templates
+	UPROPERTY(EditAnywhere, Category = Gesture)
+		FVRGestureSimplification Simplification;
+
+	// Template library shared with other components (e.g. the spell set of every player),
+	// none to record and use the recognizer's own templates
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gesture)
+		UVRGestureTemplateManager* SharedTemplates;
+
+	// Dimension of the features passed to AddFeatureSample, 0 to recognize the component location
+	UPROPERTY(EditAnywhere, Category = Gesture, meta = (ClampMin = "0", ClampMax = "32"))
+		int32 FeatureDimensions;
+
+	// Recognition levels of detail, from the most to the least detailed.
+	// The first level whose MinRelevance is below the current relevance is used
+	UPROPERTY(EditAnywhere, Category = Gesture)
+		TArray<FVRGestureRecognitionLOD> LODLevels;
+
+	// Progress thresholds raising the recognizer's OnGestureProgress, added at BeginPlay
+	UPROPERTY(EditAnywhere, Category = Gesture)
+		TArray<FVRGestureProgressTrigger> ProgressTriggers;
+
+	// Rate, change threshold and number of gestures of the OnNewGestureData events
+	UPROPERTY(EditAnywhere, Category = Gesture)
+		FVRGestureOutcomePublishing OutcomePublishing;
+
+	// Recognition outcomes while listening, see OutcomePublishing
 	UPROPERTY(BlueprintAssignable, Category = Gesture)
 		FOnNewGestureData OnNewGestureData;
 
@@ -51,6 +104,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Gesture)
 		void StopRecordGesture();
 
+	// Compression achieved on the last recorded gesture
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		FVRGestureSimplifyReport GetLastSimplifyReport();
+
 	UFUNCTION(BlueprintCallable, Category = Gesture)
 		void ClearGestures();
 
@@ -63,15 +120,66 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Gesture)
 		void StopListenGesture();
 
+	// Record or listen to an N-D feature (orientation, velocity, finger joints...), FeatureDimensions values
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		void AddFeatureSample(const TArray<float>& Features, float DeltaTime);
+
+	// Feed the recognizer with a packet of a remote input stream (FVRGestureStreamEncoder), e.g. on the server
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		void AddStreamPacket(const TArray<uint8>& Packet);
+
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		void SetMotionGate(const FVRGestureMotionGate& Gate);
+
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		void SetOutcomePublishing(const FVRGestureOutcomePublishing& Publishing);
+
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		void SetInputPipeline(const FVRGestureInputPipelineConfig& Config);
+
+	// Raise OnGestureProgress of the recognizer when a gesture reaches the thresholds, returns the trigger handle
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		int32 AddProgressTrigger(const FVRGestureProgressTrigger& Trigger);
+
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		bool RemoveProgressTrigger(int32 TriggerHandle);
+
+	// Select the recognition LOD from a relevance score (e.g. local dominant hand high, remote avatar low)
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		void SetRelevance(float NewRelevance);
+
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		float GetRelevance() const { return Relevance; }
+
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		int32 GetCurrentLOD() const { return CurrentLOD; }
+
 	UFUNCTION(BlueprintCallable, Category = Gesture)
 		void SaveTemplates();
 
 	UFUNCTION(BlueprintCallable, Category = Gesture)
 		void LoadTemplates();
 
-	//UFUNCTION(BlueprintCallable, Category = Gesture)
-	//	void AddGesture()
+	// Add a gesture template to the library, also while listening
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		bool AddGesture(UVRGestureTemplate* GestureTemplate);
+
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		bool RemoveGesture(int32 GestureID);
+
+	// Share a template library with other components, the library becomes read-only
+	UFUNCTION(BlueprintCallable, Category = Gesture)
+		bool SetSharedTemplates(UVRGestureTemplateManager* Templates);
 
 private:
 	//FVRGROutcomes FromGVFToFGR(GVFOutcomes outcomes);
+
+	void UpdateLOD();
+
+	FVRGestureInputPipeline Pipeline;
+
+	FVRGestureStreamDecoder StreamDecoder;
+
+	float Relevance;
+	int32 CurrentLOD;
 };
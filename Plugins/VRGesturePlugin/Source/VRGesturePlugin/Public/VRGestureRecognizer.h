@@ -4,10 +4,20 @@
 
 #include "Object.h"
 #include "VRGestureTypes.h"
+#include "VRGestureFeature.h"
+#include "RandomNumbers.h"
 #include "VRGestureTemplateManager.h"
+#include "VRGestureInputPipeline.h"
+#include "VRGestureTelemetry.h"
 #include "VRGestureRecognizer.generated.h"
 
+// Track the working memory of the listening recognizers, see vrgesture.AllocationAudit
+#ifndef VRGESTURE_ALLOCATION_AUDIT
+#define VRGESTURE_ALLOCATION_AUDIT !UE_BUILD_SHIPPING
+#endif
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnGestureActivated, int32, GestureID);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FOnGestureProgress, int32, GestureID, int32, TriggerHandle, int32, ThresholdIndex, float, Threshold);
 
 /**
  * 
@@ -57,8 +67,97 @@ public:
 	*/
 	void segmentation(bool segmentationFlag);
 
+	/**
+	* Spread particles near the template samples matching the current observation
+	* @details at initialisation and segmentation re-spreads, a ratio of the particles get a
+	* (gesture, progression) pair proposed by the template manager spatial index instead of a
+	* round robin gesture at the beginning. The others keep the default spreading for exploration
+	* @param proposalsFlag boolean to activate or deactivate data driven proposals
+	* @param ratio ratio of the particles proposed from the observation [0;1]
+	*/
+	void dataDrivenProposals(bool proposalsFlag, float ratio = 0.5f);
+
+	/**
+	* Run the filter at a fixed rate, independent of the frame rate
+	* @details positions passed to Tick are resampled at this rate, when recording and listening,
+	* so the cost no longer follows the headset refresh rate. The dynamics advance with the real
+	* elapsed time and the sample rate of each template, a template recorded at 90 Hz is
+	* recognized at the same speed by a 30 Hz filter. Features are not resampled but still
+	* advance with their time stamps. Tick needs its DeltaTime in this mode
+	* @param rate filter rate (Hz), 0 to update at every input sample
+	*/
+	void setFixedRate(float rate);
+
+	float getFixedRate();
+
 	//#pragma mark - [ Accessors ]
 	//#pragma mark > Parameters
+	/**
+	* Set every engine parameter at once, typically a configuration found by FVRGestureAutoTuner
+	* @details a tolerance of 0 goes back to the tolerance computed from the template ranges. Another
+	* tolerance is kept over the computed one only if it differs from the current tolerance
+	* @param parameters engine parameters
+	*/
+	void setEngineParameters(const FGREngineParameters& parameters);
+
+	/**
+	* Get the current engine parameters
+	* @return engine parameters
+	*/
+	const FGREngineParameters& getEngineParameters();
+
+	/**
+	* Get the most probable gesture after the last filter update
+	* @return gesture ID, INDEX_NONE before the first update
+	*/
+	int32 getMostProbableGesture();
+
+	/**
+	* Seed the random generator of the filter
+	* @details recognizers seeded identically, with the same templates and parameters, give
+	* the same estimates for the same inputs. Call before StartListening
+	* @param seed generator seed
+	*/
+	void setRandomSeed(uint64 seed);
+
+	/**
+	* Bit-reproducible recognition, for regression tests and replays
+	* @details each StartListening seeds the generator again, and the particles are updated in
+	* fixed blocks drawing from their own random stream (seed, update, block), on worker threads
+	* for large counts. The weight sum is added in block order, the other reductions (ESS,
+	* estimates) run in particle order. The same inputs then give the same outcomes whatever the
+	* number of threads. Across machines, results match for builds with the same floating point
+	* settings; bFastLikelihood avoids the platform exp/log in the likelihood. A deterministic
+	* recognizer is left out of the frame budget scheduler (bBudgetManaged is ignored) and is never
+	* throttled, so its update interval and particle count stay the ones requested
+	* @param deterministicFlag boolean to activate or deactivate the mode
+	* @param seed generator seed
+	*/
+	void setDeterministic(bool deterministicFlag, uint64 seed = 0);
+
+	bool isDeterministic();
+
+	/**
+	* Set the dimension of the input
+	* @details 2 or 3 for positions passed to Tick, up to VRGESTURE_MAX_FEATURE_DIMENSIONS for
+	* features passed to TickFeatures. Must be set before recording the first gesture
+	* @param dimensions number of dimensions of an input sample
+	*/
+	void setDimensions(int dimensions);
+
+	/**
+	* Get the dimension of the input
+	* @return number of dimensions of an input sample
+	*/
+	int getDimensions();
+
+	/**
+	* Set the weight of each dimension in the distance of a feature to a template
+	* @details only used by feature templates, position templates use dimWeights
+	* @param weights one weight per dimension, missing dimensions get 1
+	*/
+	void setFeatureWeights(const TArray<float>& weights);
+
 	/**
 	* Set tolerance between observation and estimation
 	* @details tolerance depends on the range of the data
@@ -74,6 +173,50 @@ public:
 	*/
 	float getTolerance();
 
+	/**
+	* Set the observation distribution
+	* @details 0 selects a Gaussian distribution scaled by the tolerance, any positive value
+	* selects a Student's t-distribution with that many degrees of freedom
+	* @param distribution degrees of freedom, or 0 for Gaussian
+	*/
+	void setDistribution(float distribution);
+
+	/**
+	* Get the observation distribution
+	* @return 0 if Gaussian, otherwise the Student's t degrees of freedom
+	*/
+	float getDistribution();
+
+	/**
+	* Use polynomial approximations instead of exp() / pow() in the likelihood
+	* @details the Gaussian likelihood has a relative error below 3e-7, the Student's likelihood
+	* below 3e-7 * (1 + (nu/2 + 1) * log2(d/nu + 1)). Very unlikely particles get the smallest
+	* normal float instead of 0. Default is false (exact evaluation)
+	* @param fastLikelihood true to use the fast approximation, false for exact evaluation
+	*/
+	void setFastLikelihood(bool fastLikelihood);
+
+	/**
+	* Get if the fast likelihood approximation is used
+	* @return true if the likelihood is approximated
+	*/
+	bool getFastLikelihood();
+
+	/**
+	* Track particle weights in the log domain
+	* @details weights are accumulated as log-likelihoods and normalised with log-sum-exp, so they
+	* never collapse to 0 even with a tight tolerance or an unexpected motion. The effective sample
+	* size used for resampling is computed on the normalised weights. Default is false
+	* @param logWeights true to use log-weights, false for linear weights
+	*/
+	void setLogWeights(bool logWeights);
+
+	/**
+	* Get if particle weights are tracked in the log domain
+	* @return true if log-weights are used
+	*/
+	bool getLogWeights();
+
 	/**
 	* Set number of particles used in estimation
 	* @details default valye is 1000, note that the computational
@@ -251,8 +394,237 @@ public:
 	void setSpreadRotations(float min, float max, int dim = -1);
 
 
-	void Tick(FVector& InputPoint);
-	void TickListening();
+	/**
+	* Set the motion gate used while listening
+	* @details when enabled, the particle filter is suspended while the input speed stays below
+	* SleepSpeed for SleepDelay seconds, and resumes as soon as the speed goes above WakeSpeed
+	* @param gate motion gate settings
+	*/
+	void setMotionGate(const FVRGestureMotionGate& gate);
+
+	/**
+	* Get if the motion gate currently suspends the filter
+	* @return true if the input is still and the filter is not updated
+	*/
+	bool isMotionGateAsleep();
+
+	/**
+	* Update the filter only once every few input samples
+	* @details observations are still recorded every sample, the skipped samples are
+	* compensated by scaling the dynamics and the noise of the next update
+	* @param updateInterval number of input samples between two updates (minimum 1)
+	*/
+	void setUpdateInterval(int updateInterval);
+
+	/**
+	* Get the number of input samples between two filter updates
+	* @return update interval
+	*/
+	int getUpdateInterval();
+
+	/**
+	* Change the number of particles without restarting the filter
+	* @details while listening, the particles are resampled from the current posterior to
+	* the new count, so the current estimates are kept. The resampling threshold keeps the
+	* same ratio to the number of particles
+	* @param numberOfParticles new number of particles
+	*/
+	void resizeParticles(int numberOfParticles);
+
+	/**
+	* Apply a recognition level of detail at runtime (particles, prediction steps and update rate)
+	* @param LOD level of detail to apply
+	*/
+	void applyLOD(const FVRGestureRecognitionLOD& LOD);
+
+	/**
+	* Throttle level decided by the frame budget scheduler
+	* @details levels 1 to 3 double the update interval each, levels 4 to MaxBudgetThrottle
+	* then halve the number of particles each. 0 disables throttling
+	* @param throttle throttle level
+	*/
+	void setBudgetThrottle(int throttle);
+
+	/**
+	* Get the current budget throttle level
+	* @return throttle level
+	*/
+	int getBudgetThrottle();
+
+	/**
+	* Priority used by the budget scheduler, lowest priority recognizers are throttled first
+	* @param priority priority value (the component uses its relevance)
+	*/
+	void setBudgetPriority(float priority);
+
+	/**
+	* Get the budget priority
+	* @return priority value
+	*/
+	float getBudgetPriority();
+
+	/**
+	* Update and return the average cost per frame of this recognizer, in microseconds
+	* @details called once per frame by the budget scheduler, resets the cost of the current frame
+	* @return averaged cost per frame in microseconds
+	*/
+	float consumeFrameCost();
+
+	static const int MaxBudgetThrottle = 6;
+
+	// If the recognizer registers to the frame budget scheduler when listening
+	bool bBudgetManaged;
+
+	virtual void BeginDestroy() override;
+
+	/**
+	* Set the template simplification applied when a recording stops
+	* @details idle samples at the beginning and the end are trimmed and the path is simplified
+	* with Douglas-Peucker. The timing of the kept samples is stored, so the dynamics are unchanged
+	* @param simplification simplification settings
+	*/
+	void setSimplification(const FVRGestureSimplification& simplification);
+
+	/**
+	* Get the result of the last template simplification
+	* @return lengths before and after simplification
+	*/
+	FVRGestureSimplifyReport getLastSimplifyReport();
+
+	/**
+	* Set the candidate prefilter
+	* @details when enabled, the directions of the last input samples are matched against coarse
+	* template directions with a subsequence DTW. Only the best matching gestures receive particles
+	* at initialisation and segmentation re-spreads, particles on discarded gestures are re-spread
+	* @param prefilter prefilter settings
+	*/
+	void setPrefilter(const FVRGesturePrefilter& prefilter);
+
+	/**
+	* Get the gestures currently considered by the particle filter
+	* @return candidate gesture IDs
+	*/
+	const TArray<int32>& getCandidateGestures();
+
+	/**
+	* Set how the recognition outcomes are published
+	* @param publishing publication rate, change threshold and number of gestures
+	*/
+	void setOutcomePublishing(const FVRGestureOutcomePublishing& publishing);
+
+	/**
+	* Decide if the outcomes should be published this frame, and fill them if so
+	* @details called once per frame by the owner. Outcomes are published at most PublishRate
+	* times per second, only after a filter update, and only if a gesture changed by more than
+	* MinChange. The outcome buffers are reused, so publication does not allocate once warmed up
+	* @param DeltaTime time since the previous call (s)
+	* @return true if getOutcomes() holds new outcomes to publish
+	*/
+	bool publishOutcomes(float DeltaTime);
+
+	/**
+	* Get the last published outcomes, sorted by decreasing probability
+	* @return outcomes buffer, valid until the next publication
+	*/
+	const FVRGROutcomes& getOutcomes();
+
+	/**
+	* Raise OnGestureProgress when the progression of a gesture reaches given thresholds
+	* @details evaluated after each filter update, only the crossings are broadcast. A threshold
+	* is reached when the estimated progression goes above it while the gesture probability is
+	* at least MinProbability, and armed again once the progression falls Hysteresis below it,
+	* e.g. when the gesture starts again. Several thresholds crossed in one update are raised in
+	* increasing order
+	* @param trigger gesture, thresholds and probability gate
+	* @return handle of the trigger
+	*/
+	int32 addProgressTrigger(const FVRGestureProgressTrigger& trigger);
+
+	/**
+	* Remove a trigger added by addProgressTrigger
+	* @param handle handle of the trigger
+	* @return false if no trigger has this handle
+	*/
+	bool removeProgressTrigger(int32 handle);
+
+	void clearProgressTriggers();
+
+	/**
+	* Number of working memory growths seen by the allocation audit
+	* @details counted while listening after a short warm up, when vrgesture.AllocationAudit
+	* is set. Always 0 if VRGESTURE_ALLOCATION_AUDIT is disabled (shipping builds)
+	* @return number of ticks which grew the working memory
+	*/
+	int32 getAuditedAllocations();
+
+	/**
+	* Capture the complete filter state into a flat buffer, for rollback and replays
+	* @details particles, random generator, input history, motion gate and per template estimates.
+	* Templates and parameters are not captured. The buffer keeps its capacity, so capturing
+	* every frame does not allocate once warmed up
+	* @param OutSnapshot buffer receiving the snapshot
+	*/
+	void saveSnapshot(TArray<uint8>& OutSnapshot);
+
+	/**
+	* Restore a state captured by saveSnapshot
+	* @details restoration is bit-exact: replaying the same inputs gives the same estimates.
+	* Fails if the recognizer state or the templates changed since the capture
+	* @param Snapshot buffer filled by saveSnapshot
+	* @return true if the state has been restored
+	*/
+	bool restoreSnapshot(const TArray<uint8>& Snapshot);
+
+	void Tick(FVector& InputPoint, float DeltaTime = 0.0f);
+
+	/**
+	* Record or listen to an N-D feature (orientation, velocity, finger joints...)
+	* @details the first 3 dimensions are used by the motion gate, the prefilter and the spatial index
+	* @param Feature feature values
+	* @param NumDimensions number of values, must be the recognizer dimension
+	* @param DeltaTime time since the previous sample (s)
+	*/
+	void TickFeatures(const float* Feature, int32 NumDimensions, float DeltaTime = 0.0f);
+
+	template <int32 Dim>
+	void TickFeatures(const TVRGestureFeature<Dim>& Feature, float DeltaTime = 0.0f)
+	{
+		TickFeatures(Feature.Data, Dim, DeltaTime);
+	}
+
+	/**
+	* Add a template to the library
+	* @details the library range is extended incrementally: the other templates are normalised
+	* again only if the new one widens it. While listening, the filter keeps running and the
+	* new gesture gets its share of the particles, re-spread from one particle out of N
+	* @param GestureTemplate template to add, its ID must not be in use
+	* @return true if the template has been added
+	*/
+	bool addGestureTemplate(UVRGestureTemplate* GestureTemplate);
+
+	/**
+	* Remove a template from the library
+	* @details while listening, the particles following the removed gesture are re-spread on
+	* the remaining candidates. Listening stops if no listened gesture is left
+	* @param GestureID ID of the template to remove
+	* @return true if the template has been removed
+	*/
+	bool removeGestureTemplate(int32 GestureID);
+
+	/**
+	* Use a template library shared with other recognizers
+	* @details the library is frozen on first use: it becomes read-only and its derived data
+	* (normalisation, prefilter directions, spatial index) is built once for every recognizer.
+	* The recognizer then only keeps its particles, estimates and listening state.
+	* Templates can not be recorded, added or removed while a shared library is used
+	* @param Library shared library, nullptr to go back to the recognizer's own library
+	* @return false if the recognizer is not idle or the templates have different feature dimensions
+	*/
+	bool setTemplateLibrary(UVRGestureTemplateManager* Library);
+
+	UVRGestureTemplateManager* getTemplateLibrary();
+
+	void TickListening(float StepScale = 1.0f);
 	void StartRecordingNewGesture(int32 GestureID);
 	void StopRecordingGesture();
 	void ClearAllGestures();
@@ -262,6 +634,9 @@ public:
 	UPROPERTY(BlueprintAssignable)
 	FOnGestureActivated OnGestureActivated; 
 
+	UPROPERTY(BlueprintAssignable)
+	FOnGestureProgress OnGestureProgress;
+
 protected:
 
 	UPROPERTY()
@@ -273,14 +648,41 @@ protected:
 	UPROPERTY()
 	EVRGestureRecognizerState   state;         // State (defined above)
 
+	UPROPERTY()
+	FVRGestureMotionGate		MotionGate;    // Suspends the filter while the input is still
+
+	UPROPERTY()
+	FVRGesturePrefilter			Prefilter;     // Cheap matcher selecting the candidate gestures
+
+	UPROPERTY()
+	FVRGestureSimplification	Simplification;    // Applied to the templates when a recording stops
+
+	UPROPERTY()
+	FVRGestureSimplifyReport	lastSimplifyReport;
+
+	UPROPERTY()
+	FVRGestureOutcomePublishing	OutcomePublishing;
+
+	UPROPERTY()
+	FVRGROutcomes				Outcomes;          // reused publication buffer
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
 	UVRGestureTemplateManager*  GestureManager;    // UVRGestureTemplate object to handle incoming data in learning and following modes
 
+	UPROPERTY()
+	UVRGestureTemplateManager*  OwnedGestureManager;  // own library, GestureManager may point to a shared one
+
+	UPROPERTY(VisibleAnywhere, Category = Gesture)
+	TMap<int32, FVRGestureEstimate> GestureEstimates;  // estimates of each template, per recognizer
+
 	UPROPERTY()
 	UVRGestureTemplate*			CurrentGesture;
 
+	UPROPERTY()
+	UVRGestureTemplate*			ListeningGesture;  // input history, reused by every listening session
+
 	FVector dimWeights;           // TOOD: to be put in parameters?
-	FVector maxRange;
+	FVector maxRange;             // range shared by every template, updated when templates are added or removed
 	FVector minRange;
 	int     dynamicsDim;                // dynamics state dimension
 	int     scalingsDim;                // scalings state dimension
@@ -288,20 +690,122 @@ protected:
 	float   globalNormalizationFactor;          // flagged if normalization
 	int     mostProbableIndex;                  // cached most probable index
 	bool	tolerancesetmanually;
+	float   likelihoodScale;                    // cached log2(e)/tol^2 (Gaussian) or 1/nu (Student) for the fast likelihood
+	float   likelihoodExponent;                 // cached -nu/2-1 for the fast Student likelihood
 	
+	FVector lastInputPoint;                     // previous input, used by the motion gate
+	float   lastInputFeature[VRGESTURE_MAX_FEATURE_DIMENSIONS]; // previous feature input, RecognizerConfig.Dimensions used
+	bool    bHasLastInput;
+	bool    bMotionGateAsleep;
+	float   motionGateStillTime;                // time spent below the sleep speed
+	int     updateInterval;                     // input samples between two filter updates
+	int     samplesSinceUpdate;                 // input samples received since the last update
+	float   timeSinceUpdate;                    // input time received since the last update (s), fixed rate only
+	float   recordingTime;                      // duration of the current recording (s)
+	FVRGestureInputPipeline fixedRateResampler; // resamples the positions at the fixed rate
+	int     requestedNumberParticles;           // number of particles before budget throttling
+	int     budgetThrottle;                     // throttle level set by the budget scheduler
+	float   budgetPriority;
+	uint32  frameCostCycles;                    // cycles spent in the filter this frame
+	float   averageFrameCostUs;
+
+	TArray<int32> listenedGestureIDs;           // gestures passed to StartListening
+	TArray<int32> candidateGestureIDs;          // subset of listened gestures receiving particles
+	TArray<FVector> windowDirections;           // prefilter scratch
+	TArray<float> dtwRow;                       // prefilter scratch
+	TArray<float> prefilterCosts;               // prefilter cost of each listened gesture
+	TArray<FVector> coarseScratch;              // coarse directions of a shared template built for another size
+
+	TArray<FGestureParticle> resampleScratch;   // workspace reserved at train()
+	TArray<float> resampleCumulative;
+	TArray<float> resampleBlockSums;            // weight of each resampler block, then its offset
+	int32   listeningHistoryCapacity;           // listening samples kept before dropping the oldest
+	int32   auditedTicks;
+	int32   auditedAllocations;
+
+	TArray<FGestureOutcome> publishedOutcomes;  // outcomes of the last publication, to detect changes
+
+	struct FProgressTriggerState
+	{
+		FVRGestureProgressTrigger Trigger;      // thresholds sorted in increasing order
+		int32 Handle;
+		int32 NumReached;                       // thresholds currently reached, from the first one
+	};
+	TArray<FProgressTriggerState> progressTriggers;
+
+	struct FProgressCrossing
+	{
+		int32 GestureID;
+		int32 Handle;
+		int32 ThresholdIndex;
+		float Threshold;
+	};
+	TArray<FProgressCrossing> progressCrossings; // crossings of the current update, broadcast after the pass
+	int32   nextProgressTriggerHandle;
+	float   timeSincePublish;
+	bool    bOutcomesDirty;                     // estimates updated since the last publication
+
+	TArray<float> featureWeights;               // distance weight of each feature dimension
+	FVRGestureDistanceKernel featureKernel;     // distance kernel of feature templates, null for position templates
+	bool    bFeatureInput;                      // the dimension was set by setDimensions, features may be recorded
+
 	FVector gestureProbabilities;
 	TArray<FGestureParticle> GestureParticles;
 
+	RandomNumbers RN;                           // per recognizer generator, captured by snapshots
+	bool    bDeterministic;                     // see setDeterministic
+	uint64  deterministicSeed;
+	uint32  deterministicUpdates;               // filter updates since StartListening, selects the block streams
+	TArray<float> tickBlockSums;                // weight sum of each particle block
+
 private:
 
 
 	//#pragma mark - Private methods for model mechanics
 	void initPrior();
+	void spreadParticle(FGestureParticle* Particle);
+	void respreadParticles(int32 GestureID, int32 RemovedGestureID);
+	bool extendRange(UVRGestureTemplate* GestureTemplate);
+	bool shrinkRange(UVRGestureTemplate* GestureTemplate);
+	void recomputeRange();
+	void applyRange(UVRGestureTemplate* GestureTemplate);
+	void initEstimates();
 	void initNoiseParameters();
-	void updateLikelihood(FVector obs, FGestureParticle* Particle, int32 ParticleIndex);
-	void updatePrior(FGestureParticle* Particle);
+	// Particle loop of TickListening, instantiated for each combination of options
+	typedef float (UVRGestureRecognizer::*FTickParticles)(const FVector& obs, float StepScale, float NoiseScale, int32 First, int32 Last, RandomNumbers& Random);
+	template <bool bTranslate, bool bSegmentation, bool bRotation, bool bGaussian>
+	float tickParticles(const FVector& obs, float StepScale, float NoiseScale, int32 First, int32 Last, RandomNumbers& Random);
+	template <bool bTranslate, bool bSegmentation, bool bRotation, bool bGaussian>
+	void updateLikelihood(const FVector& obs, FGestureParticle* Particle, int32 ParticleIndex, RandomNumbers& Random);
+	float featureDistance(UVRGestureTemplate* GestureTemplate, FGestureParticle* Particle);
+	void addInput(const FVector& InputPoint, const float* Feature, float DeltaTime);
+	template <bool bRotation>
+	void updatePrior(FGestureParticle* Particle, float StepScale, float NoiseScale, RandomNumbers& Random);
 	void updatePosterior(FGestureParticle* Particle);
+	void updateLikelihoodConstants();
+	float normaliseLogWeights();
 	void resampleAccordingToWeights(FVector obs);
 	void estimates();       // update estimated outcome
-	void train();	
+	bool train();	
+	void resampleParticles(int numberOfParticles);
+	int32 pickGestureID(int32 ParticleIndex);
+	bool proposeParticle(FGestureParticle* Particle, RandomNumbers& Random);
+	void updateCandidates();
+	int getBudgetedUpdateInterval();
+	int getBudgetedNumberOfParticles();
+	bool updateMotionGate(const FVector& InputPoint, const float* Feature, float DeltaTime);
+	void resetMotionGate();
+	void fillOutcomes();
+	void reserveWorkspace();
+	int32 getFeatureInputDimensions();
+	int32 getLongestTemplateLength();
+#if VRGESTURE_ALLOCATION_AUDIT
+	SIZE_T getWorkingMemorySize();
+	void auditAllocations(SIZE_T SizeBefore);
+#endif
+#if VRGESTURE_TELEMETRY
+	void recordTelemetry(FVRGestureTelemetry* Telemetry, float ESS, bool bResampled);
+#endif
+	bool outcomesChanged();
+	void updateProgressTriggers();
 };
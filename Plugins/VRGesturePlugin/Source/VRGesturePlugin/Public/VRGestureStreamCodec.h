@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "VRGestureTypes.h"
+
+class UVRGestureRecognizer;
+
+/**
+* Compact stream of gesture input, to run the recognizer on a dedicated server
+* @details samples are quantised with a step derived from the template range, delta coded
+* against the previous sample, zigzag mapped and bit packed with the smallest width covering
+* each axis of the packet. A packet starts with an 8 bit sequence number, so a lost packet is
+* detected: the decoder then waits for the next key sample, sent in full precision.
+* Packet layout (bits): sequence 8, samples 8, delta time 16 (0.1 ms), key 1,
+* [origin 3x32, step 3x32], widths 3x6, deltas
+*/
+class VRGESTUREPLUGIN_API FVRGestureStreamEncoder
+{
+public:
+
+	// Largest number of samples in one packet
+	static const int32 MaxSamplesPerPacket = 255;
+
+	FVRGestureStreamEncoder();
+
+	/**
+	* Set the format and the range used for the quantisation
+	* @param RangeMin lower bound of the template range
+	* @param RangeMax upper bound of the template range
+	*/
+	void SetFormat(const FVRGestureStreamFormat& InFormat, const FVector& RangeMin, const FVector& RangeMax);
+
+	// Start a new stream, the next packet holds a key sample
+	void Reset();
+
+	/**
+	* Encode a block of samples into one packet
+	* @param Samples input samples, as passed to the recognizer
+	* @param NumSamples number of samples, at most MaxSamplesPerPacket
+	* @param DeltaTime time between two samples (s)
+	* @param OutPacket receives the packet, its capacity is kept
+	*/
+	void EncodePacket(const FVector* Samples, int32 NumSamples, float DeltaTime, TArray<uint8>& OutPacket);
+
+private:
+
+	FVRGestureStreamFormat Format;
+	FVector Step;
+	FVector InvStep;
+	FVector Origin;
+	int32 Last[3];
+	uint8 Sequence;
+	int32 SamplesSinceKey;
+	bool bHasKey;
+};
+
+class VRGESTUREPLUGIN_API FVRGestureStreamDecoder
+{
+public:
+
+	FVRGestureStreamDecoder();
+
+	// Start a new stream, packets are ignored until a key sample
+	void Reset();
+
+	/**
+	* Decode one packet
+	* @param Packet packet written by FVRGestureStreamEncoder
+	* @param NumBytes size of the packet
+	* @param OutSamples decoded samples
+	* @param MaxSamples capacity of OutSamples
+	* @param OutDeltaTime time between two samples (s)
+	* @return number of samples decoded, INDEX_NONE if the packet is invalid or follows a lost packet
+	*/
+	int32 DecodePacket(const uint8* Packet, int32 NumBytes, FVector* OutSamples, int32 MaxSamples, float& OutDeltaTime);
+
+	/**
+	* Decode one packet and tick the recognizer with its samples
+	* @return number of samples passed to the recognizer
+	*/
+	int32 DecodeToRecognizer(const TArray<uint8>& Packet, UVRGestureRecognizer* Recognizer);
+
+private:
+
+	FVector Step;
+	FVector Origin;
+	int32 Last[3];
+	uint8 ExpectedSequence;
+	bool bHasKey;
+};
+
+class VRGESTUREPLUGIN_API FVRGestureStreamCodec
+{
+public:
+
+	/**
+	* Round trip of labelled trajectories through the codec, must be called from the game thread
+	* @details the first trajectory of each gesture is recorded as a template, the other ones are
+	* recognized twice by identically seeded recognizers: from the raw samples and from the
+	* decoded stream. Measures how often both agree on the most probable gesture, and the bandwidth
+	* @param Trajectories labelled recordings
+	* @param Format stream format, quantised over the range of the recorded templates
+	* @param SampleRate input samples per second
+	* @param SamplesPerPacket samples sent in one packet
+	* @return agreement, bandwidths and reconstruction error
+	*/
+	static FVRGestureStreamReport Evaluate(const TArray<FVRGestureTrajectory>& Trajectories, const FVRGestureStreamFormat& Format, float SampleRate, int32 SamplesPerPacket);
+};
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "VRGestureTypes.h"
+
+/**
+* Deterministic synthetic gestures, to judge the recognizer on quality and cost together
+* @details each gesture is a smooth random 3D curve. Queries follow the variations modelled by
+* the filter in updatePrior: relative speed and acceleration, scale of each axis, rotation,
+* plus a translation, an idle onset and gaussian noise. Everything is drawn from seeded
+* generators, the same set always gives the same trajectories
+*/
+class VRGESTUREPLUGIN_API FVRGestureSynthetic
+{
+public:
+
+	/**
+	* Generate labelled trajectories
+	* @details the first NumGestures trajectories are the undistorted templates, one per gesture,
+	* followed by the queries. This is the layout expected by FVRGestureAutoTuner
+	* @param Set generator settings
+	* @param OutTrajectories receives the trajectories
+	*/
+	static void Generate(const FVRGestureSyntheticSet& Set, TArray<FVRGestureTrajectory>& OutTrajectories);
+
+	/**
+	* Recognize a synthetic set with every configuration of a tuning space, must be called from the game thread
+	* @details reports accuracy, detection latency in samples and CPU time per tick of each configuration
+	* @param Set generator settings
+	* @param Space configurations to benchmark (particle counts, tolerances...)
+	* @param OutResults result of each configuration
+	*/
+	static void RunBenchmark(const FVRGestureSyntheticSet& Set, const FVRGestureTuningSpace& Space, TArray<FVRGestureTuningResult>& OutResults);
+};
@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "VRGestureTypes.h"
+
+// Compile the telemetry hooks of the recognizers, see vrgesture.TelemetryStart
+#ifndef VRGESTURE_TELEMETRY
+#define VRGESTURE_TELEMETRY !UE_BUILD_SHIPPING
+#endif
+
+/**
+* Binary telemetry of the particle filters, written to a file by a background thread
+* @details one frame per filter update: effective sample size, resampling, probability mass and
+* alignment of each gesture, and the progression distribution of the particles. Frames are
+* appended to a memory buffer under a lock; the writer thread swaps it with a second buffer and
+* writes it out, so recognizers never wait on the file. When no recording runs, the recognizer
+* hook is a single null pointer test. Recognizers may tick on worker threads (auto tuner) while the
+* game thread stops the recording: they access it through FScopedActive, and Stop waits for the
+* accesses in progress before deleting it. Files are converted by Decode (vrgesture.TelemetryDecode)
+*
+* File layout (little endian): magic "VRGT", version, then frames:
+* size uint16 (bytes after this field), recognizer uint32, time float (s), ess float,
+* particles uint16, flags uint8 (1: resampled), bins uint8, gestures uint16,
+* gestures x (id int32, mass float, alignment float), bins x progression mass uint16 (/65535).
+* A frame holds at most 5457 gestures, the others are left out so that its size fits 16 bits
+*/
+class VRGESTUREPLUGIN_API FVRGestureTelemetry
+{
+public:
+
+	// Bins of the progression distribution, over [0;1]
+	static const int32 NumProgressionBins = 16;
+
+	/**
+	* Start recording, stops the current recording if any. Game thread only
+	* @param Filename file to write, overwritten
+	* @return false if the file can not be opened
+	*/
+	static bool Start(const FString& Filename);
+
+	// Flush and close the recording, once the submissions in progress are done. Game thread only
+	static void Stop();
+
+	// Access to the current recording from any thread, kept alive for the lifetime of the scope
+	class FScopedActive
+	{
+	public:
+
+		FORCEINLINE FScopedActive()
+			: Telemetry(Active != nullptr ? Acquire() : nullptr)
+		{
+		}
+
+		FORCEINLINE ~FScopedActive()
+		{
+			if (Telemetry)
+				Release();
+		}
+
+		// Current recording, nullptr when telemetry is off
+		FORCEINLINE FVRGestureTelemetry* Get() const
+		{
+			return Telemetry;
+		}
+
+	private:
+
+		FVRGestureTelemetry* Telemetry;
+	};
+
+	/**
+	* Append the frame of one filter update, thread safe
+	* @param RecognizerID unique ID of the recognizer
+	* @param ESS effective sample size before resampling
+	* @param NumParticles number of particles
+	* @param bResampled the particles have been resampled in this update
+	* @param Estimates estimates of each gesture
+	* @param ProgressionMass posterior mass of each progression bin
+	*/
+	void Submit(uint32 RecognizerID, float ESS, int32 NumParticles, bool bResampled, const TMap<int32, FVRGestureEstimate>& Estimates, const float* ProgressionMass);
+
+	/**
+	* Convert a recording to CSV (one row per frame) or JSON (array of frames)
+	* @param InFilename recording
+	* @param OutFilename converted file
+	* @param bJson JSON instead of CSV
+	* @return false if the recording can not be read or is invalid
+	*/
+	static bool Decode(const FString& InFilename, const FString& OutFilename, bool bJson);
+
+	~FVRGestureTelemetry();
+
+private:
+
+	class FWriter;
+
+	FVRGestureTelemetry();
+
+	static FVRGestureTelemetry* Acquire();
+	static void Release();
+
+	static FVRGestureTelemetry* volatile Active;
+	static FThreadSafeCounter NumUsers;    // accesses in progress, counted before Active is read
+
+	FCriticalSection BufferLock;
+	TArray<uint8> Buffer;          // frames waiting for the writer
+	double StartTime;
+	FWriter* Writer;
+};
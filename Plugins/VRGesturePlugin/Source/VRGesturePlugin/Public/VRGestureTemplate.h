@@ -3,6 +3,7 @@
 #pragma once
 
 #include "Object.h"
+#include "VRGestureTypes.h"
 #include "VRGestureTemplate.generated.h"
 
 /**
@@ -28,6 +29,14 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
 		FVector observationRangeMin;
 
+	// Extent of the template's own samples. Once the template is in a library the
+	// observation range above is the range shared by every template of the library
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
+		FVector sampleRangeMax;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
+		FVector sampleRangeMin;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
 		FVector templateInitialObservation;
 
@@ -37,25 +46,51 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
 		TArray< FVector > templateRaw;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		TArray< FVector > templateNormal;
+	// Samples quantised on 16 bits over the sample range, 3 per sample. This is the form read
+	// by the recognizer: templateRaw keeps full precision for editing and is released by the
+	// libraries frozen at runtime. Built by normalise(), cleared by any edit
+	UPROPERTY()
+		TArray< int16 > templateQuantised;
+
+	// Decoded sample = quantiseOrigin + quantised * quantiseStep
+	UPROPERTY()
+		FVector quantiseOrigin;
 
+	UPROPERTY()
+		FVector quantiseStep;
+
+	// Progression [0;1[ of each sample once simplified, empty if every recorded sample is kept
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		float probabilityNormalisation;
+		TArray< float > templateTimes;
+
+	// Feature dimension of an N-D template, 0 for a position (FVector) template
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		float   estimatedAlignment;         // ..
+		int32 featureDimensions;
+
+	// Samples of an N-D template, featureDimensions floats per sample, relative to the first one.
+	// templateRaw keeps the first 3 dimensions so lengths, prefilter and spatial index still work
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		FVector estimatedDynamics;          // ..
+		TArray< float > templateFeatures;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		FVector estimatedScalings;          // ..
+		TArray< float > templateInitialFeature;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		FVector	estimatedRotations;         // ..
+		TArray< float > featureRangeMax;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		float   estimatedProbabilities;     // ..
+		TArray< float > featureRangeMin;
+
+	// Number of recorded samples covered by the template, 0 if not simplified
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		float   estimatedLikelihoods;       // ..
+		int32 templateDuration;
+
+	// Rate (Hz) of the recorded samples, 0 if the recording had no time stamps
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Gesture)
-		float   absoluteLikelihoods;        // ..
+		float templateSampleRate;
+
+	// The estimates of the recognition are held by each recognizer (FVRGestureEstimate):
+	// a template is read-only while listening and can be shared by several recognizers
 
 
 public:
@@ -77,19 +112,6 @@ public:
 		bAutoAdjustNormalRange = b;
 	}
 
-	void InitEstimates(int32 TotalNumberGestures)
-	{
-		probabilityNormalisation = 0;
-		estimatedAlignment = 0; 
-
-		estimatedDynamics = FVector::ZeroVector;
-		estimatedScalings = FVector::ZeroVector;
-		estimatedRotations = FVector::ZeroVector;
-
-		estimatedProbabilities = 0; 
-		estimatedLikelihoods = 0; 
-	}
-
 	//void setMax(float x, float y, float z) {
 	//	assert(inputDimensions == 3);
 	//	FVector r;
@@ -106,14 +128,23 @@ public:
 
 	void normalise()
 	{ 
-		templateNormal.SetNumUninitialized(templateRaw.Num());
-
 		FVector MaxMin = observationRangeMax - observationRangeMin; 
-		for (int i = 0; i < templateRaw.Num(); i++)
-		{
-			templateNormal[i] = templateRaw[i] / MaxMin;
-		}
 		templateInitialNormal = templateInitialObservation / MaxMin;
+		quantise();
+	}
+
+	// Build the compact samples from the full precision ones, a released template is kept as is
+	void quantise();
+
+	// Free the full precision samples, the template can then only be read (frozen libraries)
+	void releaseRawSamples() {
+		if (templateQuantised.Num() == templateRaw.Num() * 3)
+			templateRaw.Empty();
+	}
+
+	// Only the compact samples are left, see releaseRawSamples
+	bool isReleased() const {
+		return templateRaw.Num() == 0 && templateQuantised.Num() > 0;
 	}
 
 	void setMaxRange(FVector observationRangeMax) {
@@ -128,6 +159,13 @@ public:
 		normalise();
 	}
 
+	// Set both bounds of the observation range, the template is normalised once
+	void setRange(const FVector& observationRangeMin, const FVector& observationRangeMax) {
+		this->observationRangeMin = observationRangeMin;
+		this->observationRangeMax = observationRangeMax;
+		normalise();
+	}
+
 	FVector& getMaxRange() {
 		return observationRangeMax;
 	}
@@ -149,6 +187,26 @@ public:
 
 		observationRangeMax.Z = FMath::Max(observationRangeMax.Z, observation.Z);
 		observationRangeMin.Z = FMath::Min(observationRangeMin.Z, observation.Z);
+
+		sampleRangeMax = sampleRangeMax.ComponentMax(observation);
+		sampleRangeMin = sampleRangeMin.ComponentMin(observation);
+	}
+
+	bool hasSampleRange() {
+		return sampleRangeMin.X <= sampleRangeMax.X;
+	}
+
+	// Rebuild the sample extent, for templates saved before it was stored
+	void computeSampleRange() {
+		sampleRangeMax = FVector(-INFINITY);
+		sampleRangeMin = FVector(INFINITY);
+		int32 Length = getTemplateLength();
+		for (int32 i = 0; i < Length; i++)
+		{
+			FVector Sample = getSample(i);
+			sampleRangeMax = sampleRangeMax.ComponentMax(Sample);
+			sampleRangeMin = sampleRangeMin.ComponentMin(Sample);
+		}
 	}
 
 	void addObservation(FVector observation) {
@@ -164,22 +222,142 @@ public:
 
 		// store the raw observation
 		templateRaw.Add(observation);
+		templateQuantised.Reset();
 
+		// normalised once the template is added to a library, not at every sample
 		ClampObservation(observation);
+	}
 
-		normalise();
+	// Add an N-D sample, every sample of the template must have the same dimension
+	void addFeatureObservation(const float* feature, int32 numDimensions) {
+
+		if (featureDimensions == 0 || templateFeatures.Num() == 0)
+		{
+			featureDimensions = numDimensions;
+			inputDimensions = numDimensions;
+			templateInitialFeature.SetNumUninitialized(numDimensions);
+			featureRangeMax.Init(-INFINITY, numDimensions);
+			featureRangeMin.Init(INFINITY, numDimensions);
+			for (int32 k = 0; k < numDimensions; k++)
+				templateInitialFeature[k] = feature[k];
+		}
+
+		int32 Offset = templateFeatures.AddUninitialized(featureDimensions);
+		float* Sample = &templateFeatures[Offset];
+		for (int32 k = 0; k < featureDimensions; k++)
+		{
+			Sample[k] = feature[k] - templateInitialFeature[k];
+			featureRangeMax[k] = FMath::Max(featureRangeMax[k], Sample[k]);
+			featureRangeMin[k] = FMath::Min(featureRangeMin[k], Sample[k]);
+		}
+
+		FVector Position(Sample[0], featureDimensions > 1 ? Sample[1] : 0.0f, featureDimensions > 2 ? Sample[2] : 0.0f);
+		templateRaw.Add(Position);
+		templateQuantised.Reset();
+		ClampObservation(Position);
+	}
+
+	// N-D sample at a given progression [0;1], N-D templates are never simplified
+	const float* getFeatureAt(float cursor) {
+		int Length = getTemplateLength();
+		return &templateFeatures[FMath::Clamp((int)FMath::FloorToFloat(cursor * Length), 0, Length - 1) * featureDimensions];
+	}
+
+	const float* getLastFeature() {
+		return &templateFeatures[templateFeatures.Num() - featureDimensions];
+	}
+
+	// Width of the observed range on one dimension
+	float getRangeWidth(int32 dim) {
+		if (featureDimensions > 0)
+			return dim < featureDimensions ? featureRangeMax[dim] - featureRangeMin[dim] : 0.0f;
+		return dim < 3 ? observationRangeMax[dim] - observationRangeMin[dim] : 0.0f;
 	}
 
 	int getNumberDimensions() {
 		return inputDimensions;
 	}
 
-	int getTemplateLength() {
-		return templateRaw.Num();
+	// Unit directions of the template path, sampled at NumDirections + 1 regular points
+	// Used by the recognizer prefilter as a cheap descriptor
+	TArray<FVector> coarseDirections;
+
+	void buildCoarseDirections(int32 NumDirections)
+	{
+		buildCoarseDirections(NumDirections, coarseDirections);
+	}
+
+	// Same, into a caller buffer: shared templates are not modified while listening
+	void buildCoarseDirections(int32 NumDirections, TArray<FVector>& OutDirections) const
+	{
+		OutDirections.SetNumUninitialized(NumDirections, false);
+		int32 Length = getTemplateLength();
+		for (int32 i = 0; i < NumDirections; i++)
+		{
+			if (Length == 0)
+			{
+				OutDirections[i] = FVector::ZeroVector;
+				continue;
+			}
+			FVector From = getSample(FMath::Min(i * (Length - 1) / NumDirections, Length - 1));
+			FVector To = getSample(FMath::Min((i + 1) * (Length - 1) / NumDirections, Length - 1));
+			OutDirections[i] = (To - From).GetSafeNormal();
+		}
+	}
+
+	int getTemplateLength() const {
+		return templateRaw.Num() > 0 ? templateRaw.Num() : templateQuantised.Num() / 3;
 	}
 
-	FVector& getLastObservation() {
-		return templateRaw.Last();
+	// Stored sample, decoded from the compact form when it is up to date
+	FORCEINLINE FVector getSample(int32 Index) const {
+		if (templateQuantised.Num() == 0)
+			return templateRaw[Index];
+
+		const int16* Quantised = &templateQuantised[Index * 3];
+		return quantiseOrigin + FVector(Quantised[0], Quantised[1], Quantised[2]) * quantiseStep;
+	}
+
+	// Length in recorded samples, used to advance the progression
+	int getTemplateDuration() {
+		return templateTimes.Num() > 0 ? templateDuration : getTemplateLength();
+	}
+
+	// Template sample at a given progression [0;1]
+	FVector getSampleAt(float cursor) {
+		int Length = getTemplateLength();
+		if (templateTimes.Num() == 0)
+		{
+			return getSample(FMath::Clamp((int)FMath::FloorToFloat(cursor * Length), 0, Length - 1));
+		}
+
+		// simplified template: interpolate between the kept samples
+		if (cursor <= templateTimes[0])
+			return getSample(0);
+		if (cursor >= templateTimes[Length - 1])
+			return getSample(Length - 1);
+
+		int Low = 0;
+		int High = Length - 1;
+		while (High - Low > 1)
+		{
+			int Mid = (Low + High) / 2;
+			if (templateTimes[Mid] <= cursor) Low = Mid;
+			else High = Mid;
+		}
+		float Alpha = (cursor - templateTimes[Low]) / (templateTimes[High] - templateTimes[Low]);
+		return FMath::Lerp(getSample(Low), getSample(High), Alpha);
+	}
+
+	// Progression of the sample at a given index
+	float getSampleTime(int Index) {
+		return templateTimes.Num() > 0 ? templateTimes[Index] : (float)Index / (float)getTemplateLength();
+	}
+
+	FVRGestureSimplifyReport simplify(float IdleDistance, float Tolerance);
+
+	FVector getLastObservation() {
+		return getSample(getTemplateLength() - 1);
 	}
 
 	FVector& getInitialObservation() {
@@ -187,25 +365,46 @@ public:
 	}
 
 
+	// Reserve the sample storage, Reset() keeps it. numFeatureDimensions is 0 for position input
+	void reserve(int32 numSamples, int32 numFeatureDimensions) {
+		templateRaw.Reserve(numSamples);
+		if (numFeatureDimensions > 0)
+			templateFeatures.Reserve(numSamples * numFeatureDimensions);
+	}
+
+	// Forget the oldest samples of a listening history, in place
+	void dropOldestSamples(int32 numSamples) {
+		numSamples = FMath::Min(numSamples, templateRaw.Num());
+		templateRaw.RemoveAt(0, numSamples, false);
+		templateQuantised.Reset();
+		if (featureDimensions > 0)
+			templateFeatures.RemoveAt(0, numSamples * featureDimensions, false);
+	}
+
+	// Clear the samples and estimates, the capacity is kept for the next gesture
 	void Reset()
 	{
-		templateRaw.Empty();
-		templateNormal.Empty();
+		templateRaw.Reset();
+		templateQuantised.Reset();
+		templateTimes.Reset();
+		templateDuration = 0;
+		templateSampleRate = 0.0f;
+		coarseDirections.Reset();
+		featureDimensions = 0;
+		templateFeatures.Reset();
+		templateInitialFeature.Reset();
+		featureRangeMax.Reset();
+		featureRangeMin.Reset();
 
 		// TODO Check why -Infinity for max range :O 
 		observationRangeMax = FVector(-INFINITY);
 		observationRangeMin = FVector(INFINITY);
+		sampleRangeMax = FVector(-INFINITY);
+		sampleRangeMin = FVector(INFINITY);
 
 		templateInitialObservation = FVector::ZeroVector;
 		templateInitialNormal = FVector::ZeroVector;
-		probabilityNormalisation =0;
-		estimatedAlignment = 0;
-		estimatedDynamics = FVector::ZeroVector;
-		estimatedScalings = FVector::ZeroVector;
-		estimatedRotations = FVector::ZeroVector;
-		estimatedProbabilities = 0;
-		estimatedLikelihoods = 0;
-		absoluteLikelihoods = 0;
-
+		quantiseOrigin = FVector::ZeroVector;
+		quantiseStep = FVector::ZeroVector;
 	}
 };
@@ -26,6 +26,9 @@ public:
 		:Super(X)
 	{
 		inputDimensions = 3;
+		SpatialIndexCellSize = 0.1f;
+		bSpatialIndexDirty = true;
+		bReadOnly = false;
 	}
 
 	/*// Add a new input data to a gesture template, or create a new gesture if doesn't exist 
@@ -73,6 +76,7 @@ public:
 	}
 
 
+	// Full precision samples, empty for the templates of a library frozen at runtime
 	TArray<FVector>& getTemplate(int templateIndex = 0) {
 		return (*GestureTemplates.Find(templateIndex))->templateRaw; 
 	}
@@ -93,7 +97,7 @@ public:
 		return inputDimensions;
 	}
 
-	FVector& getLastObservation(int templateIndex = 0) {
+	FVector getLastObservation(int templateIndex = 0) {
 		return (*GestureTemplates.Find(templateIndex))->getLastObservation(); 
 	}
 	/*
@@ -104,14 +108,86 @@ public:
 
 	void deleteTemplate(int templateIndex = 0)
 	{
+		if (bReadOnly)
+			return;
 		GestureTemplates.Remove(templateIndex);
+		bSpatialIndexDirty = true;
 	}
 
 	void clear()
 	{
+		if (bReadOnly)
+			return;
 		GestureTemplates.Empty(); 
+		bSpatialIndexDirty = true;
+	}
+
+	/**
+	* Make the library read-only so that it can be shared by several recognizers
+	* @details the derived data is built once here: templates normalised to the range of
+	* the library, coarse directions of the prefilter and spatial index. Recognizers then
+	* only read the templates, from any thread. The library stays alive as long as a
+	* recognizer references it. Outside the editor the full precision samples are released,
+	* templates are then only read in their 16 bit form
+	* @param NumCoarseDirections number of coarse directions used by the prefilter
+	* @return false if the templates have different feature dimensions, the library is then left unchanged
+	*/
+	bool Freeze(int32 NumCoarseDirections);
+
+	// Every template has the same feature dimension (0 for position templates), true if the library is empty
+	bool HasUniformFeatureDimensions() const
+	{
+		int32 FeatureDimensions = INDEX_NONE;
+		for (auto& Elem : GestureTemplates)
+		{
+			if (FeatureDimensions != INDEX_NONE && Elem.Value->featureDimensions != FeatureDimensions)
+				return false;
+			FeatureDimensions = Elem.Value->featureDimensions;
+		}
+		return true;
+	}
+
+	bool IsReadOnly() const
+	{
+		return bReadOnly;
+	}
+
+	// Range shared by the templates of the library, false if the library is empty
+	bool GetRange(FVector& OutMin, FVector& OutMax)
+	{
+		if (GestureTemplates.Num() == 0)
+			return false;
+
+		UVRGestureTemplate* FirstTemplate = GestureTemplates.CreateIterator().Value();
+		OutMin = FirstTemplate->getMinRange();
+		OutMax = FirstTemplate->getMaxRange();
+		return true;
+	}
+
+	// Size of the spatial index cells, in normalised template units
+	UPROPERTY(EditAnywhere, Category = Gesture)
+	float SpatialIndexCellSize;
+
+	/**
+	* Propose a (gesture, progression) pair whose template sample is close to an observation
+	* @details template samples are indexed in a uniform grid over the normalised template space,
+	* rebuilt lazily when templates change. The cell of the observation and its neighbours are
+	* searched, and one of the samples found is picked uniformly
+	* @param Observation observation in template space (relative to the gesture start)
+	* @param AllowedIDs gestures that can be proposed, every gesture if empty
+	* @param RandomValue uniform random value in [0;1) used to pick the sample
+	* @return true if a sample was found near the observation
+	*/
+	bool ProposeFromObservation(const FVector& Observation, const TArray<int32>& AllowedIDs, float RandomValue, int32& OutGestureID, float& OutProgression);
+
+	void BuildSpatialIndex();
+
+	// Build the spatial index now if templates changed, before proposals from several threads
+	void UpdateSpatialIndex()
+	{
+		if (bSpatialIndexDirty)
+			BuildSpatialIndex();
 	}
-	void InitEstimates();
 
 	TArray<int32> GetAllGestureIDs()
 	{
@@ -128,5 +204,28 @@ public:
 	
 	bool AddNewGesture(UVRGestureTemplate* CurrentGesture);
 	float GetTemplateLength(int32 GestureId);
+
+	// Length in samples at a given rate (Hz), templates without a rate are taken as recorded at this rate
+	float GetTemplateLengthAtRate(int32 GestureID, float SampleRate);
 	int32 GetGestureIDFromParticleIndex(int32 ParticleIndex);
+
+private:
+
+	struct FSpatialSample
+	{
+		FIntVector Cell;
+		int32 GestureID;
+		float Progression;
+	};
+
+	FIntVector GetSpatialCell(const FVector& Observation) const;
+
+	// samples sorted by cell, each cell maps to its [start, start + count) range
+	TArray<FSpatialSample> SpatialSamples;
+	TMap<FIntVector, FIntPoint> SpatialCells;
+	FVector SpatialInvRange;
+	bool bSpatialIndexDirty;
+
+	// set by Freeze, not saved: a loaded library is frozen again by the recognizers sharing it
+	bool bReadOnly;
 };
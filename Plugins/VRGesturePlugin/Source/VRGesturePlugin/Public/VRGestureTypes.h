@@ -10,7 +10,7 @@ struct FVRGestureRecognizerConfig
 {
 	GENERATED_USTRUCT_BODY()
 
-	// Dimension of input points [2;3]
+	// Dimension of the input: 2 or 3 for positions (Tick), up to VRGESTURE_MAX_FEATURE_DIMENSIONS for features (TickFeatures)
 	UPROPERTY(EditDefaultsOnly)
 	int32 Dimensions;
 
@@ -21,6 +21,18 @@ struct FVRGestureRecognizerConfig
 	// If should segment after a completed gesture 
 	UPROPERTY(EditDefaultsOnly)
 	bool bSegmentation;
+
+	// If particles should be (re)spread near template samples matching the current observation
+	UPROPERTY(EditDefaultsOnly)
+	bool bDataDrivenProposals;
+
+	// Ratio of the (re)spread particles proposed from the observation [0;1]
+	UPROPERTY(EditDefaultsOnly)
+	float ProposalRatio;
+
+	// Rate (Hz) the filter runs at whatever the input rate, 0 updates at every input sample
+	UPROPERTY(EditDefaultsOnly)
+	float FixedRate;
 }; 
 
 
@@ -71,6 +83,527 @@ struct FGREngineParameters
 	int32 predictionSteps;
 	UPROPERTY(EditDefaultsOnly)
 	FVector dimWeights;
+	// Use polynomial exp/log approximations in the likelihood (see fastExp2)
+	UPROPERTY(EditDefaultsOnly)
+	bool bFastLikelihood;
+	// Accumulate particle weights in the log domain (log-sum-exp normalisation)
+	UPROPERTY(EditDefaultsOnly)
+	bool bLogWeights;
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureMotionGate
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Suspend the particle filter while the input is still
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	bool bEnabled;
+
+	// Speed (units/s) below which the input is considered still
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float SleepSpeed;
+
+	// Speed (units/s) above which the filter resumes, higher than SleepSpeed for hysteresis
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float WakeSpeed;
+
+	// Time (s) the input must stay still before the filter is suspended
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float SleepDelay;
+
+	// Re-spread the particles from the wake up point instead of resuming the frozen state
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	bool bResetOnWake;
+
+	FVRGestureMotionGate()
+		: bEnabled(false)
+		, SleepSpeed(5.0f)
+		, WakeSpeed(15.0f)
+		, SleepDelay(0.25f)
+		, bResetOnWake(true)
+	{
+	}
+};
+
+UENUM(BlueprintType)
+enum class EVRGestureInputFeature : uint8
+{
+	Position,
+	Velocity,
+	Acceleration
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureInputPipelineConfig
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Low-pass the input with a one-euro filter
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	bool bOneEuroFilter;
+
+	// Cutoff frequency (Hz) of the one-euro filter at rest, lower removes more jitter
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float MinCutoff;
+
+	// Increase of the cutoff with the speed, higher reduces the lag of fast motions
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float Beta;
+
+	// Cutoff frequency (Hz) used to smooth the speed estimate
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float DerivativeCutoff;
+
+	// Resample the input at a fixed rate
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	bool bResample;
+
+	// Resampling rate (Hz)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float ResampleRate;
+
+	// Feature passed to the recognizer
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	EVRGestureInputFeature Feature;
+
+	FVRGestureInputPipelineConfig()
+		: bOneEuroFilter(false)
+		, MinCutoff(1.0f)
+		, Beta(0.01f)
+		, DerivativeCutoff(1.0f)
+		, bResample(false)
+		, ResampleRate(90.0f)
+		, Feature(EVRGestureInputFeature::Position)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureSimplification
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Simplify the templates when a recording stops
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	bool bEnabled;
+
+	// Samples closer than this distance (units) to the first / last sample are trimmed as idle
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float IdleDistance;
+
+	// Maximum distance (units) between the simplified and the recorded path
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float Tolerance;
+
+	FVRGestureSimplification()
+		: bEnabled(false)
+		, IdleDistance(0.5f)
+		, Tolerance(0.2f)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureSimplifyReport
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Number of recorded samples
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 RecordedLength;
+
+	// Samples trimmed at the beginning and at the end
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 TrimmedHead;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 TrimmedTail;
+
+	// Number of samples stored in the template
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 SimplifiedLength;
+
+	// RecordedLength / SimplifiedLength
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float CompressionRatio;
+
+	FVRGestureSimplifyReport()
+		: RecordedLength(0)
+		, TrimmedHead(0)
+		, TrimmedTail(0)
+		, SimplifiedLength(0)
+		, CompressionRatio(1.0f)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGesturePrefilter
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Restrict the particles to the gestures matching the recent input directions
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	bool bEnabled;
+
+	// Number of recent input samples compared to the templates
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 WindowSize;
+
+	// Number of directions the window is reduced to
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 WindowDirections;
+
+	// Number of directions the templates are reduced to
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 TemplateDirections;
+
+	// Maximum number of gestures passed to the particle filter
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 MaxCandidates;
+
+	// Gestures whose matching cost is within this margin of the best one are kept [0;2]
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float CostMargin;
+
+	// Minimum path length of the window (units) to trust its directions
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float MinWindowPath;
+
+	FVRGesturePrefilter()
+		: bEnabled(false)
+		, WindowSize(24)
+		, WindowDirections(6)
+		, TemplateDirections(16)
+		, MaxCandidates(4)
+		, CostMargin(0.3f)
+		, MinWindowPath(5.0f)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureRecognitionLOD
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Lowest relevance score for which this level is selected
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float MinRelevance;
+
+	// Number of particles used at this level
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 NumberParticles;
+
+	// Number of prediction steps per update
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 PredictionSteps;
+
+	// The filter is updated once every UpdateInterval input samples
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 UpdateInterval;
+
+	FVRGestureRecognitionLOD()
+		: MinRelevance(0.0f)
+		, NumberParticles(1000)
+		, PredictionSteps(1)
+		, UpdateInterval(1)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureOutcomePublishing
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Publish the recognition outcomes (OnNewGestureData) while listening
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	bool bEnabled;
+
+	// Maximum number of publications per second, 0 publishes after every filter update
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0"))
+	float PublishRate;
+
+	// Publish only when the probability or the progression of a gesture changed by more than this, 0 always publishes
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0"))
+	float MinChange;
+
+	// Number of most probable gestures published, 0 publishes every gesture
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0"))
+	int32 TopK;
+
+	FVRGestureOutcomePublishing()
+		: bEnabled(true)
+		, PublishRate(30.0f)
+		, MinChange(0.01f)
+		, TopK(0)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureProgressTrigger
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Gesture followed by the trigger
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 GestureID;
+
+	// Progressions [0;1] raising OnGestureProgress when reached, e.g. every 0.1
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	TArray<float> Thresholds;
+
+	// Thresholds are only reached while the gesture is at least this probable
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MinProbability;
+
+	// A reached threshold is armed again once the progression falls this far below it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0"))
+	float Hysteresis;
+
+	FVRGestureProgressTrigger()
+		: GestureID(INDEX_NONE)
+		, MinProbability(0.5f)
+		, Hysteresis(0.05f)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureTrajectory
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Gesture performed in this trajectory
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 GestureID;
+
+	// Input samples, as passed to the recognizer
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	TArray<FVector> Points;
+
+	// Idle samples before the gesture starts, 0 if unknown
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 Onset;
+
+	FVRGestureTrajectory()
+		: GestureID(0)
+		, Onset(0)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureSyntheticSet
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Same seed, same trajectories
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	int32 Seed;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "1"))
+	int32 NumGestures;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0"))
+	int32 QueriesPerGesture;
+
+	// Samples of a template
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "4"))
+	int32 TemplateLength;
+
+	// Extent of a template on each axis (cm)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float GestureSize;
+
+	// Relative speed of a query, drawn in [1 - SpeedVariation; 1 + SpeedVariation] (GVF dynamics, speed)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0", ClampMax = "0.9"))
+	float SpeedVariation;
+
+	// Relative speed change from the start to the end of a query (GVF dynamics, acceleration)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0", ClampMax = "0.9"))
+	float AccelerationVariation;
+
+	// Scale of each axis of a query, drawn in [1 - ScaleVariation; 1 + ScaleVariation] (GVF scalings)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0", ClampMax = "0.9"))
+	float ScaleVariation;
+
+	// Largest rotation of a query around each axis, in radians (GVF rotations)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float RotationVariation;
+
+	// Standard deviation of the noise added to each sample, relative to GestureSize
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	float Noise;
+
+	// Largest number of idle samples before a query starts
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0"))
+	int32 MaxOnset;
+
+	FVRGestureSyntheticSet()
+		: Seed(1)
+		, NumGestures(8)
+		, QueriesPerGesture(125)
+		, TemplateLength(60)
+		, GestureSize(30.0f)
+		, SpeedVariation(0.3f)
+		, AccelerationVariation(0.2f)
+		, ScaleVariation(0.2f)
+		, RotationVariation(0.0f)
+		, Noise(0.02f)
+		, MaxOnset(10)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureStreamFormat
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Quantisation precision: the template range is split in 2^PrecisionBits steps on each axis
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "4", ClampMax = "16"))
+	int32 PrecisionBits;
+
+	// Minimum number of samples between two key samples. A key sample is sent in full precision
+	// at the start of a packet, so that a receiver can join the stream or recover from a lost packet
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "1"))
+	int32 KeyInterval;
+
+	FVRGestureStreamFormat()
+		: PrecisionBits(8)
+		, KeyInterval(64)
+	{
+	}
+};
+
+USTRUCT()
+struct FVRGestureStreamReport
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Ratio of the samples where the raw and decoded streams give the same most probable gesture
+	UPROPERTY()
+	float Agreement;
+
+	// Bandwidth of the uncompressed FVector stream
+	UPROPERTY()
+	float RawBytesPerSecond;
+
+	// Bandwidth of the encoded stream, packet headers and key samples included
+	UPROPERTY()
+	float EncodedBytesPerSecond;
+
+	// Largest distance between a raw and a decoded sample
+	UPROPERTY()
+	float MaxError;
+
+	FVRGestureStreamReport()
+		: Agreement(0.0f)
+		, RawBytesPerSecond(0.0f)
+		, EncodedBytesPerSecond(0.0f)
+		, MaxError(0.0f)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureTuningSpace
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Candidate numbers of particles
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	TArray<int32> NumberParticles;
+
+	// Candidate tolerances, 0 uses the tolerance computed from the template ranges
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	TArray<float> Tolerances;
+
+	// Candidate resampling thresholds, as a ratio of the number of particles
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	TArray<float> ResamplingRatios;
+
+	// Candidate values of FGREngineParameters::dynamicsVariance (same value on every axis)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	TArray<float> DynamicsVariances;
+
+	// Candidate values of FGREngineParameters::scalingsVariance (same value on every axis)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
+	TArray<float> ScalingsVariances;
+
+	FVRGestureTuningSpace()
+	{
+		NumberParticles.Add(100);
+		NumberParticles.Add(250);
+		NumberParticles.Add(500);
+		NumberParticles.Add(1000);
+		Tolerances.Add(0.0f);
+		ResamplingRatios.Add(0.25f);
+		ResamplingRatios.Add(0.5f);
+		DynamicsVariances.Add(0.1f);
+		ScalingsVariances.Add(0.003f);
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FVRGestureTuningTarget
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Ratio of the test trajectories that must be recognized [0;1]
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MinAccuracy;
+
+	// Mean progression of a trajectory after which the right gesture must stay the most probable [0;1]
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MaxLatency;
+
+	FVRGestureTuningTarget()
+		: MinAccuracy(0.9f)
+		, MaxLatency(0.6f)
+	{
+	}
+};
+
+USTRUCT()
+struct FVRGestureTuningResult
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	FGREngineParameters Parameters;
+
+	// Ratio of the test trajectories recognized
+	UPROPERTY()
+	float Accuracy;
+
+	// Mean progression at which the recognized trajectories were decided
+	UPROPERTY()
+	float Latency;
+
+	// Mean number of samples from the gesture onset to the decision, for the recognized trajectories
+	UPROPERTY()
+	float LatencySamples;
+
+	// Mean cost of a recognizer tick, in microseconds
+	UPROPERTY()
+	float CostUs;
+
+	UPROPERTY()
+	bool bMeetsTarget;
+
+	FVRGestureTuningResult()
+		: Accuracy(0.0f)
+		, Latency(1.0f)
+		, LatencySamples(0.0f)
+		, CostUs(0.0f)
+		, bMeetsTarget(false)
+	{
+	}
 };
 
 UENUM()
@@ -113,6 +646,7 @@ struct FGestureParticle
 	UPROPERTY()
 	float Weight;
 
+	// Only maintained when bLogWeights is not set
 	UPROPERTY()
 	float Likelihood; 
 
@@ -121,6 +655,60 @@ struct FGestureParticle
 
 	UPROPERTY()
 	float Posterior;
+
+	// Log-domain counterparts, only maintained when bLogWeights is set
+	UPROPERTY()
+	float LogLikelihood;
+
+	UPROPERTY()
+	float LogPosterior;
+};
+
+// Estimates of one gesture, computed from the particles of a recognizer.
+// Kept by the recognizer so that templates can be shared by several recognizers
+USTRUCT()
+struct FVRGestureEstimate
+{
+	GENERATED_USTRUCT_BODY()
+
+	// Sum of the posteriors of the particles following the gesture
+	UPROPERTY()
+	float probabilityNormalisation;
+
+	UPROPERTY()
+	float alignment;
+
+	UPROPERTY()
+	FVector dynamics;
+
+	UPROPERTY()
+	FVector scalings;
+
+	UPROPERTY()
+	FVector rotations;
+
+	UPROPERTY()
+	float probability;
+
+	// Sum of the particle likelihoods, left at 0 when bLogWeights is set
+	UPROPERTY()
+	float likelihood;
+
+	FVRGestureEstimate()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		probabilityNormalisation = 0.0f;
+		alignment = 0.0f;
+		dynamics = FVector::ZeroVector;
+		scalings = FVector::ZeroVector;
+		rotations = FVector::ZeroVector;
+		probability = 0.0f;
+		likelihood = 0.0f;
+	}
 };
 
 USTRUCT(Blueprintable)
@@ -140,6 +728,16 @@ struct FGestureOutcome
 	FVector scaling;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gesture")
 	FVector rotation;
+
+	FGestureOutcome()
+		: GestureIndex(INDEX_NONE)
+		, likelihood(0.0f)
+		, alignment(0.0f)
+		, dynamic(FVector::ZeroVector)
+		, scaling(FVector::ZeroVector)
+		, rotation(FVector::ZeroVector)
+	{
+	}
 };
 
 USTRUCT(Blueprintable)
@@ -191,6 +789,20 @@ inline vector<vector<float> > getRotationMatrix3d(T phi, T theta, T psi)
 	return M;
 }
 
+//--------------------------------------------------------------
+// Same rotation as getRotationMatrix3d applied to a FVector, without allocations
+inline FVector rotate3d(const FVector& V, float phi, float theta, float psi)
+{
+	const float cphi = cos(phi), sphi = sin(phi);
+	const float ctheta = cos(theta), stheta = sin(theta);
+	const float cpsi = cos(psi), spsi = sin(psi);
+
+	return FVector(
+		ctheta * cpsi * V.X + (-cphi * spsi + sphi * stheta * cpsi) * V.Y + (sphi * spsi + cphi * stheta * cpsi) * V.Z,
+		ctheta * spsi * V.X + (cphi * cpsi + sphi * stheta * spsi) * V.Y + (-sphi * cpsi + cphi * stheta * spsi) * V.Z,
+		-stheta * V.X + sphi * ctheta * V.Y + cphi * ctheta * V.Z);
+}
+
 //--------------------------------------------------------------
 template <typename T>
 inline vector<T> multiplyMat(vector< vector<T> > & M1, vector< T> & Vect) {
@@ -216,6 +828,44 @@ float distance_weightedEuclidean(vector<T> x, vector<T> y, vector<T> w)
 	return dist;
 }
 
+//--------------------------------------------------------------
+// Fast 2^x approximation used by the likelihood when bFastLikelihood is set.
+// Range reduction to [-0.5;0.5] followed by a degree 6 Taylor polynomial:
+// relative error is below 3e-7 for x in [-126;127]. Inputs below -126 are
+// clamped, so the result never flushes to zero (smallest normal float instead).
+// Branch free apart from the clamp, so loops over particles can vectorize.
+inline float fastExp2(float x)
+{
+	x = FMath::Clamp(x, -126.0f, 127.0f);
+	const float fi = FMath::FloorToFloat(x + 0.5f);
+	const float f = x - fi;
+	union { float f; int32 i; } bits;
+	bits.f = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f + f * (0.00961812911f + f * (0.00133335581f + f * 0.000154035304f)))));
+	bits.i += (int32)fi << 23;
+	return bits.f;
+}
+
+//--------------------------------------------------------------
+// Fast log2(x) approximation for positive normal floats.
+// The mantissa is reduced to [sqrt(0.5);sqrt(2)] and ln(m) is evaluated with
+// the atanh series truncated after t^7: error is below 2e-7 * max(1, |log2(x)|).
+inline float fastLog2(float x)
+{
+	union { float f; int32 i; } bits;
+	bits.f = x;
+	float e = (float)(((bits.i >> 23) & 0xff) - 127);
+	bits.i = (bits.i & 0x007fffff) | 0x3f800000;
+	float m = bits.f;
+	if (m > 1.41421356f)
+	{
+		m *= 0.5f;
+		e += 1.0f;
+	}
+	const float t = (m - 1.0f) / (m + 1.0f);
+	const float t2 = t * t;
+	return e + t * (2.88539008f + t2 * (0.961796694f + t2 * (0.577078016f + t2 * 0.412198583f)));
+}
+
 // Example usage
 //GetEnumValueAsString<EVictoryEnum>("EVictoryEnum", VictoryEnum)));
 // from: https://wiki.unrealengine.com/Enums_For_Both_C%2B%2B_and_BP#Get_Name_of_Enum_as_String